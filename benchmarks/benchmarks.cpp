@@ -0,0 +1,410 @@
+#include <algorithm>
+#include <benchmark/benchmark.h>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bindable_properties.h"
+#include "parallel_propagation.h"
+#include "property_store.h"
+
+namespace bp = bindable_properties;
+
+static constexpr int NUM_READS = 1024;
+
+static void BM_ReadValueInt(benchmark::State& state)
+{
+    bp::property<int> prop = 42;
+
+    for (auto _ : state) {
+        int sum = 0;
+        for (int i = 0; i < NUM_READS; i++) {
+            sum += prop.value();
+            benchmark::ClobberMemory();
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * NUM_READS);
+}
+BENCHMARK(BM_ReadValueInt);
+
+static void BM_ReadPeekInt(benchmark::State& state)
+{
+    bp::property<int> prop = 42;
+
+    for (auto _ : state) {
+        int sum = 0;
+        for (int i = 0; i < NUM_READS; i++) {
+            sum += prop.peek();
+            benchmark::ClobberMemory();
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * NUM_READS);
+}
+BENCHMARK(BM_ReadPeekInt);
+
+static void BM_ReadImplicitInt(benchmark::State& state)
+{
+    bp::property<int> prop = 42;
+
+    for (auto _ : state) {
+        int sum = 0;
+        for (int i = 0; i < NUM_READS; i++) {
+            const int& value = prop;
+            sum += value;
+            benchmark::ClobberMemory();
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * NUM_READS);
+}
+BENCHMARK(BM_ReadImplicitInt);
+
+static void BM_ReadValueString(benchmark::State& state)
+{
+    bp::property<std::string> prop =
+        std::string("a string long enough to not fit in the small buffer");
+
+    for (auto _ : state) {
+        std::size_t sum = 0;
+        for (int i = 0; i < NUM_READS; i++) {
+            sum += prop.value().size();
+            benchmark::ClobberMemory();
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * NUM_READS);
+}
+BENCHMARK(BM_ReadValueString);
+
+static void BM_ReadPeekString(benchmark::State& state)
+{
+    bp::property<std::string> prop =
+        std::string("a string long enough to not fit in the small buffer");
+
+    for (auto _ : state) {
+        std::size_t sum = 0;
+        for (int i = 0; i < NUM_READS; i++) {
+            sum += prop.peek().size();
+            benchmark::ClobberMemory();
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * NUM_READS);
+}
+BENCHMARK(BM_ReadPeekString);
+
+static void BM_ReadImplicitString(benchmark::State& state)
+{
+    bp::property<std::string> prop =
+        std::string("a string long enough to not fit in the small buffer");
+
+    for (auto _ : state) {
+        std::size_t sum = 0;
+        for (int i = 0; i < NUM_READS; i++) {
+            const std::string& value = prop;
+            sum += value.size();
+            benchmark::ClobberMemory();
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * NUM_READS);
+}
+BENCHMARK(BM_ReadImplicitString);
+
+static void BM_LambdaBinding(benchmark::State& state)
+{
+    bp::property<int> x = 1;
+    bp::property<int> y = 2;
+    bp::property<int> z;
+
+    z.set_binding([&]() { return x.value() * 2 + y.value(); });
+
+    int i = 0;
+    for (auto _ : state) {
+        x = i++;
+        benchmark::DoNotOptimize(z.peek());
+    }
+}
+BENCHMARK(BM_LambdaBinding);
+
+static void BM_ExpressionBinding(benchmark::State& state)
+{
+    using namespace bp::expressions;
+
+    bp::property<int> x = 1;
+    bp::property<int> y = 2;
+    bp::property<int> z;
+
+    z.bind(x * 2 + y);
+
+    int i = 0;
+    for (auto _ : state) {
+        x = i++;
+        benchmark::DoNotOptimize(z.peek());
+    }
+}
+BENCHMARK(BM_ExpressionBinding);
+
+static void BM_LambdaBindingSetup(benchmark::State& state)
+{
+    bp::property<int> x = 1;
+    bp::property<int> y = 2;
+    bp::property<int> z;
+
+    for (auto _ : state) {
+        z.set_binding([&]() { return x.value() * 2 + y.value(); });
+        benchmark::DoNotOptimize(z.peek());
+    }
+}
+BENCHMARK(BM_LambdaBindingSetup);
+
+static void BM_ExpressionBindingSetup(benchmark::State& state)
+{
+    using namespace bp::expressions;
+
+    bp::property<int> x = 1;
+    bp::property<int> y = 2;
+    bp::property<int> z;
+
+    for (auto _ : state) {
+        z.bind(x * 2 + y);
+        benchmark::DoNotOptimize(z.peek());
+    }
+}
+BENCHMARK(BM_ExpressionBindingSetup);
+
+static void BM_TwoWayConversionRoundTrip(benchmark::State& state)
+{
+    bp::property<double> celsius;
+    bp::property<double> fahrenheit;
+
+    fahrenheit.set_binding(
+        [&]() { return celsius.value() * 9 / 5 + 32; },
+        [&](double value) { celsius.request_change((value - 32) * 5 / 9); });
+    celsius.set_binding(
+        [&]() { return (fahrenheit.value() - 32) * 5 / 9; },
+        [&](double value) { fahrenheit.request_change(value * 9 / 5 + 32); });
+
+    double i = 0;
+    for (auto _ : state) {
+        celsius.request_change(i++);
+        benchmark::DoNotOptimize(fahrenheit.peek());
+    }
+}
+BENCHMARK(BM_TwoWayConversionRoundTrip);
+
+// a binding that burns some CPU, so that the cost of the propagation itself
+// is negligible
+static long heavy_binding(long input)
+{
+    // unsigned, so that the multiplication wraps instead of overflowing
+    std::uint64_t result = static_cast<std::uint64_t>(input);
+    for (int i = 0; i < 20000; i++)
+        result =
+            (result * 6364136223846793005ULL + 1442695040888963407ULL) >> 1;
+    return static_cast<long>(result);
+}
+
+static constexpr int NUM_STORED_VIEWS = 4096;
+
+// every reallocation of the vector moves, and so relinks, all the views
+static void BM_ViewsInVector(benchmark::State& state)
+{
+    bp::property<int> prop = 42;
+
+    for (auto _ : state) {
+        std::vector<bp::property<int>> views;
+        for (int i = 0; i < NUM_STORED_VIEWS; i++)
+            views.emplace_back(prop);
+        benchmark::DoNotOptimize(views.data());
+    }
+    state.SetItemsProcessed(state.iterations() * NUM_STORED_VIEWS);
+}
+BENCHMARK(BM_ViewsInVector);
+
+// the views stay put, and only their handles are relocated
+static void BM_ViewsInStore(benchmark::State& state)
+{
+    bp::property<int> prop = 42;
+
+    for (auto _ : state) {
+        bp::property_store<int> store;
+        std::vector<bp::property_handle> views;
+        for (int i = 0; i < NUM_STORED_VIEWS; i++)
+            views.push_back(store.create(prop));
+        benchmark::DoNotOptimize(views.data());
+    }
+    state.SetItemsProcessed(state.iterations() * NUM_STORED_VIEWS);
+}
+BENCHMARK(BM_ViewsInStore);
+
+// views next to each other in memory
+static void BM_NotifyPackedViews(benchmark::State& state)
+{
+    bp::property<int> prop = 0;
+    std::vector<bp::property<int>> views;
+    views.reserve(state.range(0));
+    for (int i = 0; i < state.range(0); i++)
+        views.emplace_back(prop);
+
+    int value = 0;
+    for (auto _ : state)
+        prop = ++value;
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_NotifyPackedViews)->Arg(16)->Arg(1024)->Arg(10000);
+
+// views allocated one by one, interleaved with other allocations and
+// subscribed in random order, like views scattered across objects
+static void BM_NotifySpreadViews(benchmark::State& state)
+{
+    std::vector<std::unique_ptr<bp::property<int>>> storage;
+    std::vector<std::unique_ptr<char[]>> padding;
+    for (int i = 0; i < state.range(0); i++) {
+        storage.emplace_back(new bp::property<int>);
+        padding.emplace_back(new char[256]);
+    }
+    std::shuffle(storage.begin(), storage.end(), std::mt19937{42});
+
+    bp::property<int> prop = 0;
+    for (auto& view : storage)
+        *view = prop;
+
+    int value = 0;
+    for (auto _ : state)
+        prop = ++value;
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_NotifySpreadViews)->Arg(16)->Arg(1024)->Arg(10000);
+
+// every view has a notifier
+static void BM_NotifyViewsWithNotifiers(benchmark::State& state)
+{
+    bp::property<int> prop = 0;
+    std::vector<bp::property<int>> views;
+    views.reserve(state.range(0));
+
+    long sum = 0;
+    for (int i = 0; i < state.range(0); i++) {
+        views.emplace_back(prop);
+        views.back().set_notifier([&sum](int v) { sum += v; });
+    }
+
+    int value = 0;
+    for (auto _ : state)
+        prop = ++value;
+    benchmark::DoNotOptimize(sum);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_NotifyViewsWithNotifiers)->Arg(16)->Arg(1024)->Arg(10000);
+
+// a config struct with 50 members, each of them used by one binding
+struct wide_config {
+    int f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15,
+        f16, f17, f18, f19, f20, f21, f22, f23, f24, f25, f26, f27, f28, f29,
+        f30, f31, f32, f33, f34, f35, f36, f37, f38, f39, f40, f41, f42, f43,
+        f44, f45, f46, f47, f48, f49;
+};
+
+static int wide_config::*const wide_fields[] = {
+    &wide_config::f0, &wide_config::f1, &wide_config::f2, &wide_config::f3,
+    &wide_config::f4, &wide_config::f5, &wide_config::f6, &wide_config::f7,
+    &wide_config::f8, &wide_config::f9, &wide_config::f10, &wide_config::f11,
+    &wide_config::f12, &wide_config::f13, &wide_config::f14, &wide_config::f15,
+    &wide_config::f16, &wide_config::f17, &wide_config::f18, &wide_config::f19,
+    &wide_config::f20, &wide_config::f21, &wide_config::f22, &wide_config::f23,
+    &wide_config::f24, &wide_config::f25, &wide_config::f26, &wide_config::f27,
+    &wide_config::f28, &wide_config::f29, &wide_config::f30, &wide_config::f31,
+    &wide_config::f32, &wide_config::f33, &wide_config::f34, &wide_config::f35,
+    &wide_config::f36, &wide_config::f37, &wide_config::f38, &wide_config::f39,
+    &wide_config::f40, &wide_config::f41, &wide_config::f42, &wide_config::f43,
+    &wide_config::f44, &wide_config::f45, &wide_config::f46, &wide_config::f47,
+    &wide_config::f48, &wide_config::f49
+};
+
+static constexpr int NUM_WIDE_FIELDS = 50;
+
+// writes one member at a time, every binding reading the whole struct
+static void BM_WideConfigBindingsOnSource(benchmark::State& state)
+{
+    bp::property<wide_config> cfg = wide_config{};
+    std::vector<bp::property<int>> bindings(NUM_WIDE_FIELDS);
+    for (int i = 0; i < NUM_WIDE_FIELDS; i++) {
+        bindings[i].set_binding(
+            [&cfg, i]() { return cfg.value().*wide_fields[i] * 2; });
+    }
+
+    int field = 0;
+    for (auto _ : state) {
+        wide_config value = cfg.peek();
+        value.*wide_fields[field] += 1;
+        cfg = value;
+        field = (field + 1) % NUM_WIDE_FIELDS;
+    }
+}
+BENCHMARK(BM_WideConfigBindingsOnSource);
+
+// same, every binding reading its member through a selector
+static void BM_WideConfigBindingsOnSelectors(benchmark::State& state)
+{
+    bp::property<wide_config> cfg = wide_config{};
+    std::vector<bp::property_selector<wide_config, int>> selectors;
+    selectors.reserve(NUM_WIDE_FIELDS);
+    std::vector<bp::property<int>> bindings(NUM_WIDE_FIELDS);
+    for (int i = 0; i < NUM_WIDE_FIELDS; i++) {
+        selectors.push_back(cfg.select(wide_fields[i]));
+        bp::property_selector<wide_config, int>* selector = &selectors[i];
+        bindings[i].set_binding([selector]() { return selector->value() * 2; });
+    }
+
+    int field = 0;
+    for (auto _ : state) {
+        wide_config value = cfg.peek();
+        value.*wide_fields[field] += 1;
+        cfg = value;
+        field = (field + 1) % NUM_WIDE_FIELDS;
+    }
+}
+BENCHMARK(BM_WideConfigBindingsOnSelectors);
+
+static void BM_ParallelPropagation(benchmark::State& state)
+{
+    static constexpr int NUM_CHAINS = 64;
+    static constexpr int CHAIN_LENGTH = 4;
+
+    std::vector<std::unique_ptr<bp::property<long>>> inputs;
+    std::vector<std::unique_ptr<bp::property<long>>> chains;
+
+    for (int i = 0; i < NUM_CHAINS; i++) {
+        inputs.emplace_back(new bp::property<long>(0));
+
+        bp::property<long>* prev = inputs.back().get();
+        for (int j = 0; j < CHAIN_LENGTH; j++) {
+            chains.emplace_back(new bp::property<long>);
+            chains.back()->set_binding(
+                [prev]() { return heavy_binding(prev->value()); });
+            prev = chains.back().get();
+        }
+    }
+
+    bp::thread_pool pool{static_cast<unsigned>(state.range(0))};
+
+    long value = 0;
+    for (auto _ : state) {
+        bp::propagation_batch batch{pool};
+        value++;
+        for (auto& input : inputs)
+            *input = value;
+    }
+    state.SetItemsProcessed(state.iterations() * NUM_CHAINS * CHAIN_LENGTH);
+}
+BENCHMARK(BM_ParallelPropagation)
+    ->Arg(1)
+    ->Arg(4)
+    ->Arg(16)
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
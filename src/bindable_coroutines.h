@@ -0,0 +1,197 @@
+#ifndef BINDABLE_COROUTINES_H
+#define BINDABLE_COROUTINES_H
+
+#include "bindable_properties.h"
+
+#include <coroutine>
+#include <utility>
+
+#ifndef __cpp_impl_coroutine
+#    error "bindable_coroutines.h requires C++20 coroutines"
+#endif
+
+// C++20 awaitables on top of property notifications. This header is opt-in,
+// the library itself only requires C++11.
+//
+// Resumption always goes through a user supplied scheduler, which is any
+// type with a `schedule(std::coroutine_handle<>)` member function. The
+// scheduler must not resume the coroutine from inside `schedule`, since it is
+// called while the property is notifying its views.
+//
+// Awaiting never allocates: the subscription is a view of the property that
+// lives inside the awaiter, and so inside the coroutine frame. If the awaited
+// property is destroyed, the coroutine is never resumed.
+namespace bindable_properties
+{
+namespace coroutines
+{
+
+// `co_await changed(prop, scheduler)` resumes after the next change of prop,
+// and evaluates to the value it changed to
+template <typename T, typename Scheduler>
+class change_awaiter
+{
+public:
+    change_awaiter(const property<T>& prop_, Scheduler& scheduler_) :
+        prop{&prop_}, scheduler{&scheduler_}
+    {
+    }
+
+    change_awaiter(const change_awaiter&) = delete;
+    change_awaiter& operator=(const change_awaiter&) = delete;
+
+    bool await_ready() const noexcept { return false; }
+
+    void await_suspend(std::coroutine_handle<> handle_)
+    {
+        handle = handle_;
+        view = *prop;
+        view.set_notifier([this](const T& value) {
+            if (handle) {
+                result = value;
+                scheduler->schedule(std::exchange(handle, nullptr));
+            }
+        });
+    }
+
+    T await_resume() { return std::move(result); }
+
+private:
+    const property<T>* prop;
+    Scheduler* scheduler;
+    std::coroutine_handle<> handle;
+    property<T> view;
+    T result;
+};
+
+// `co_await until(prop, pred, scheduler)` resumes once pred(value) holds for
+// the value of prop, without suspending if it already holds
+template <typename T, typename Predicate, typename Scheduler>
+class until_awaiter
+{
+public:
+    until_awaiter(const property<T>& prop_, Predicate pred_,
+                  Scheduler& scheduler_) :
+        prop{&prop_}, pred{std::move(pred_)}, scheduler{&scheduler_}
+    {
+    }
+
+    until_awaiter(const until_awaiter&) = delete;
+    until_awaiter& operator=(const until_awaiter&) = delete;
+
+    bool await_ready()
+    {
+        if (pred(prop->peek())) {
+            result = prop->peek();
+            return true;
+        }
+        return false;
+    }
+
+    void await_suspend(std::coroutine_handle<> handle_)
+    {
+        handle = handle_;
+        view = *prop;
+        view.set_notifier([this](const T& value) {
+            if (handle && pred(value)) {
+                result = value;
+                scheduler->schedule(std::exchange(handle, nullptr));
+            }
+        });
+    }
+
+    T await_resume() { return std::move(result); }
+
+private:
+    const property<T>* prop;
+    Predicate pred;
+    Scheduler* scheduler;
+    std::coroutine_handle<> handle;
+    property<T> view;
+    T result;
+};
+
+// An async generator of the successive values of a property:
+//
+//     auto stream = changes(prop, scheduler);
+//     while (true) {
+//         T value = co_await stream.next();
+//     }
+//
+// The stream subscribes once for its whole lifetime. Changes that happen
+// while nobody is awaiting are coalesced, so `next()` always yields the
+// latest value.
+template <typename T, typename Scheduler>
+class change_stream
+{
+public:
+    class next_awaiter
+    {
+    public:
+        explicit next_awaiter(change_stream& stream_) : stream{&stream_} {}
+
+        bool await_ready() const noexcept { return stream->pending; }
+
+        void await_suspend(std::coroutine_handle<> handle)
+        {
+            stream->waiting = handle;
+        }
+
+        T await_resume()
+        {
+            stream->pending = false;
+            return stream->view.peek();
+        }
+
+    private:
+        change_stream* stream;
+    };
+
+    change_stream(const property<T>& prop, Scheduler& scheduler_) :
+        scheduler{&scheduler_}, view{prop}, pending{false}
+    {
+        view.set_notifier([this](const T&) {
+            pending = true;
+            if (waiting) {
+                scheduler->schedule(std::exchange(waiting, nullptr));
+            }
+        });
+    }
+
+    change_stream(const change_stream&) = delete;
+    change_stream& operator=(const change_stream&) = delete;
+
+    next_awaiter next() { return next_awaiter{*this}; }
+
+private:
+    Scheduler* scheduler;
+    property<T> view;
+    std::coroutine_handle<> waiting;
+    bool pending;
+};
+
+template <typename T, typename Scheduler>
+change_awaiter<T, Scheduler> changed(const property<T>& prop,
+                                     Scheduler& scheduler)
+{
+    return {prop, scheduler};
+}
+
+template <typename T, typename Predicate, typename Scheduler>
+until_awaiter<T, Predicate, Scheduler>
+until(const property<T>& prop, Predicate pred, Scheduler& scheduler)
+{
+    return {prop, std::move(pred), scheduler};
+}
+
+template <typename T, typename Scheduler>
+change_stream<T, Scheduler> changes(const property<T>& prop,
+                                    Scheduler& scheduler)
+{
+    return {prop, scheduler};
+}
+
+} // namespace coroutines
+} // namespace bindable_properties
+
+#endif // BINDABLE_COROUTINES_H
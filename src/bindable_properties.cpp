@@ -1,7 +1,10 @@
 #include "bindable_properties.h"
 
+#include <atomic>
+#include <cstdint>
 #include <functional>
 #include <memory>
+#include <utility>
 #include <vector>
 
 namespace bindable_properties
@@ -9,63 +12,261 @@ namespace bindable_properties
 namespace details
 {
 
+BINDABLE_PROPERTIES_INLINE std::atomic<std::size_t>& live_states()
+{
+    static std::atomic<std::size_t> num_live_states{0};
+    return num_live_states;
+}
+
+BINDABLE_PROPERTIES_INLINE void binding_state_created() { live_states()++; }
+BINDABLE_PROPERTIES_INLINE void binding_state_destroyed() { live_states()--; }
+
 struct binding_state {
-    binding_state(const property_base& prop_) : prop{prop_} {}
+    binding_state(const property_base& prop_) : prop{prop_}
+    {
+        binding_state_created();
+    }
+
+    binding_state(const binding_state&) = delete;
+    binding_state& operator=(const binding_state&) = delete;
+
+    ~binding_state() { binding_state_destroyed(); }
 
     property_base prop;
     std::vector<property_base> deps;
 };
 
-static thread_local bool _is_currently_binding = false;
-static thread_local std::shared_ptr<binding_state> _binding_state = {};
+// the thread locals live inside functions rather than at namespace scope so
+// that every translation unit shares the same instance when the library is
+// built header-only
+BINDABLE_PROPERTIES_INLINE bool& currently_binding()
+{
+    static thread_local bool is_currently_binding = false;
+    return is_currently_binding;
+}
+
+BINDABLE_PROPERTIES_INLINE std::shared_ptr<binding_state>& current_state()
+{
+    static thread_local std::shared_ptr<binding_state> state = {};
+    return state;
+}
+
+// properties whose writes are currently being propagated, innermost last
+BINDABLE_PROPERTIES_INLINE std::vector<const property_base*>& notifying()
+{
+    static thread_local std::vector<const property_base*> props;
+    return props;
+}
+
+// owners whose setters are currently running, innermost last
+BINDABLE_PROPERTIES_INLINE std::vector<const property_base*>& requesting()
+{
+    static thread_local std::vector<const property_base*> props;
+    return props;
+}
+
+BINDABLE_PROPERTIES_INLINE unsigned& cycle_iterations()
+{
+    static thread_local unsigned max_iterations = 0;
+    return max_iterations;
+}
+
+struct notifying_guard {
+    notifying_guard(const property_base* prop) { notifying().push_back(prop); }
+    ~notifying_guard() { notifying().pop_back(); }
+};
+
+BINDABLE_PROPERTIES_INLINE bool begin_change_request(const property_base* prop)
+{
+    std::vector<const property_base*>& props = requesting();
+    for (const property_base* p : props) {
+        if (p == prop)
+            return false;
+    }
+
+    props.push_back(prop);
+    return true;
+}
 
-void set_currently_binding(bool val) { _is_currently_binding = val; }
-bool is_currently_binding() { return _is_currently_binding; }
+BINDABLE_PROPERTIES_INLINE void end_change_request()
+{
+    requesting().pop_back();
+}
 
-void set_current_prop(property_base* prop)
+BINDABLE_PROPERTIES_INLINE void set_currently_binding(bool val)
 {
-    _binding_state = std::make_shared<binding_state>(*prop);
+    currently_binding() = val;
+}
+BINDABLE_PROPERTIES_INLINE bool is_currently_binding()
+{
+    return currently_binding();
 }
 
-void register_property(property_base* bound_prop)
+BINDABLE_PROPERTIES_INLINE
+std::shared_ptr<binding_state> set_current_prop(property_base* prop)
 {
+    if (prop)
+        current_state() = std::make_shared<binding_state>(*prop);
+    else
+        current_state().reset();
+
+    return current_state();
+}
+
+BINDABLE_PROPERTIES_INLINE void register_property(property_base* bound_prop)
+{
+    std::shared_ptr<binding_state>& current = current_state();
+
     // don't register already registered props
-    for (const auto& p : _binding_state->deps) {
+    for (const auto& p : current->deps) {
         if (p.owner == bound_prop->owner)
             return;
     }
 
-    _binding_state->deps.push_back(*bound_prop);
+    current->deps.push_back(*bound_prop);
 
-    std::shared_ptr<binding_state> state = _binding_state;
+    // the subscription points to the state, which owns it and is owned by
+    // the binder of the bound property
+    current->deps.back().func = dependency_subscriber{&current->prop};
+    current->deps.back().set_notify_mode(notify_mode::value);
+}
 
-    _binding_state->deps.back().func = [state](property_base*, void*,
-                                               details::call_type type) {
-        if (type == details::call_type::notification) {
-            if (state->prop.owner) {
-                state->prop.owner->update();
-            }
-        }
-    };
+BINDABLE_PROPERTIES_INLINE std::vector<property_base*>*& deferred()
+{
+    static thread_local std::vector<property_base*>* dirty = nullptr;
+    return dirty;
+}
+
+BINDABLE_PROPERTIES_INLINE
+void defer_updates(std::vector<property_base*>* dirty)
+{
+    deferred() = dirty;
+}
+
+BINDABLE_PROPERTIES_INLINE std::vector<property_base*>* deferred_updates()
+{
+    return deferred();
+}
+
+BINDABLE_PROPERTIES_INLINE void update(property_base* prop) { prop->update(); }
+
+BINDABLE_PROPERTIES_INLINE
+void collect_dependents(property_base* prop,
+                        std::vector<property_base*>& dependents)
+{
+    property_base* source = prop->owner;
+    if (!source)
+        return;
+
+    // only the subscriptions of bindings answer, and they are never passive
+    const subscriber_list& subscribers = source->subscribers;
+    for (std::size_t i = 0; i < subscribers.size(); i++) {
+        if (subscribers[i].mode == notify_mode::none)
+            continue;
+
+        property_base* sub = subscribers[i].prop;
+        sub->func(sub, &dependents, call_type::dependents);
+    }
+}
+
+BINDABLE_PROPERTIES_INLINE
+void dependency_subscriber::operator()(property_base*, void* value,
+                                       call_type type)
+{
+    property_base* bound_prop = bound->owner;
+    if (!bound_prop)
+        return;
+
+    switch (type) {
+    case call_type::notification:
+        if (std::vector<property_base*>* dirty = deferred())
+            dirty->push_back(bound_prop);
+        else
+            bound_prop->update();
+        break;
+    case call_type::dependents:
+        static_cast<std::vector<property_base*>*>(value)->push_back(
+            bound_prop);
+        break;
+    default:
+        break;
+    }
+}
+
+BINDABLE_PROPERTIES_INLINE
+void subscriber_list::push_back(const subscriber& sub)
+{
+    if (count == capacity) {
+        std::uint32_t new_capacity = capacity < 4 ? 4 : capacity * 2;
+        subscriber* grown = new subscriber[new_capacity];
+        for (std::uint32_t i = 0; i < count; i++)
+            grown[i] = data()[i];
+
+        if (capacity > 1)
+            delete[] storage.heap;
+        storage.heap = grown;
+        capacity = new_capacity;
+    }
+
+    data()[count++] = sub;
+}
+
+BINDABLE_PROPERTIES_INLINE void subscriber_list::clear()
+{
+    if (capacity > 1)
+        delete[] storage.heap;
+
+    storage.local = subscriber{nullptr, notify_mode::none};
+    count = 0;
+    capacity = 1;
+}
+
+BINDABLE_PROPERTIES_INLINE
+void subscriber_list::swap(subscriber_list& other) noexcept
+{
+    std::swap(storage, other.storage);
+    std::swap(count, other.count);
+    std::swap(capacity, other.capacity);
 }
 
 } // namespace details
 
-property_base::property_base() noexcept :
-    owner{this}, next{nullptr}, prev{nullptr}, func{}
+BINDABLE_PROPERTIES_INLINE std::size_t live_binding_states()
 {
+    return details::live_states();
 }
 
-property_base::property_base(const property_base& other) noexcept
+BINDABLE_PROPERTIES_INLINE void set_max_cycle_iterations(unsigned n)
+{
+    details::cycle_iterations() = n;
+}
+
+BINDABLE_PROPERTIES_INLINE unsigned max_cycle_iterations()
+{
+    return details::cycle_iterations();
+}
+
+BINDABLE_PROPERTIES_INLINE property_base::property_base() noexcept :
+    owner{this}, func{}, index{0}, mode{details::notify_mode::none},
+    num_old_value_listeners{0}, notify_depth{0}, has_empty_slots{false}
+{
+}
+
+BINDABLE_PROPERTIES_INLINE
+property_base::property_base(const property_base& other) noexcept :
+    func{}, index{0}, mode{details::notify_mode::none},
+    num_old_value_listeners{0}, notify_depth{0}, has_empty_slots{false}
 {
     attach_to(other);
 }
 
+BINDABLE_PROPERTIES_INLINE
 property_base::property_base(property_base&& other) noexcept : property_base()
 {
     operator=(std::move(other));
 }
 
+BINDABLE_PROPERTIES_INLINE
 property_base& property_base::operator=(const property_base& other)
 {
     detach();
@@ -73,101 +274,206 @@ property_base& property_base::operator=(const property_base& other)
     return *this;
 }
 
+BINDABLE_PROPERTIES_INLINE
 property_base& property_base::operator=(property_base&& other)
 {
     detach();
 
-    attach_to(other);
+    // this takes over func from other, and the notifications it wants
     func = std::move(other.func);
     if (other.is_owner()) {
-        property_base* crawler = &other;
-
-        while (crawler != nullptr) {
-            crawler->owner = this;
-            crawler = crawler->next;
+        owner = this;
+        subscribers.swap(other.subscribers);
+        for (std::size_t i = 0; i < subscribers.size(); i++) {
+            if (subscribers[i].prop)
+                subscribers[i].prop->owner = this;
         }
+        has_empty_slots = other.has_empty_slots;
+        other.has_empty_slots = false;
+
+        // other may be moved from while it is notifying, in which case its
+        // notifications won't compact the slots it left behind anymore
+        if (has_empty_slots && notify_depth == 0)
+            remove_empty_slots();
+
+        // other was already counted by itself
+        num_old_value_listeners = other.num_old_value_listeners;
+        mode = other.mode;
+        other.num_old_value_listeners = 0;
+        other.mode = details::notify_mode::none;
+        other.owner = nullptr;
+    } else {
+        mode = other.mode;
+        attach_to(other);
+        other.detach();
     }
-    other.detach();
 
     return *this;
 }
 
+BINDABLE_PROPERTIES_INLINE
 property_base::~property_base() noexcept { detach(); }
 
+BINDABLE_PROPERTIES_INLINE
 void property_base::attach_to(const property_base& other)
 {
-    next = other.next;
-    prev = const_cast<property_base*>(&other);
-    if (other.next)
-        other.next->prev = const_cast<property_base*>(this);
-    other.next = const_cast<property_base*>(this);
     owner = other.owner;
+    if (!owner)
+        return;
+
+    index = static_cast<std::uint32_t>(owner->subscribers.size());
+    owner->subscribers.push_back(details::subscriber{this, mode});
+
+    if (mode == details::notify_mode::change)
+        owner->num_old_value_listeners++;
 }
 
-void property_base::detach()
+BINDABLE_PROPERTIES_INLINE void property_base::detach()
 {
     if (is_owner()) {
-        if (next) {
-            property_base* crawler = next;
-            crawler->prev = nullptr;
-
-            while (crawler != nullptr) {
-                crawler->owner = nullptr;
-                crawler = crawler->next;
-            }
+        for (std::size_t i = 0; i < subscribers.size(); i++) {
+            if (subscribers[i].prop)
+                subscribers[i].prop->owner = nullptr;
+        }
+
+        subscribers.clear();
+        num_old_value_listeners = 0;
+        has_empty_slots = false;
+    } else if (owner) {
+        if (mode == details::notify_mode::change)
+            owner->num_old_value_listeners--;
+
+        details::subscriber_list& list = owner->subscribers;
+        if (owner->notify_depth > 0) {
+            list[index] =
+                details::subscriber{nullptr, details::notify_mode::none};
+            owner->has_empty_slots = true;
+        } else {
+            list.swap_remove(index);
+            if (index < list.size() && list[index].prop)
+                list[index].prop->index = index;
         }
-    } else {
-        if (prev)
-            prev->next = next;
-        if (next)
-            next->prev = prev;
     }
 
-    next = nullptr;
-    prev = nullptr;
     owner = nullptr;
 }
 
-void property_base::notify_all(void* value)
+// removes the empty slots once the outermost notification is over, also when
+// a notifier throws
+struct property_base::notify_depth_guard {
+    explicit notify_depth_guard(property_base* prop_) : prop{prop_}
+    {
+        prop->notify_depth++;
+    }
+    ~notify_depth_guard()
+    {
+        prop->notify_depth--;
+        if (prop->notify_depth == 0 && prop->has_empty_slots)
+            prop->remove_empty_slots();
+    }
+    notify_depth_guard(const notify_depth_guard&) = delete;
+    notify_depth_guard& operator=(const notify_depth_guard&) = delete;
+    property_base* prop;
+};
+
+BINDABLE_PROPERTIES_INLINE
+void property_base::notify_all(void* value, void* old_value)
+{
+    details::notifying_guard guard{this};
+
+    // views read through to the owner, so they all see the new value before
+    // any of them is notified, and a single pass over the subscribers is
+    // enough. Passive ones and empty slots are skipped without touching them
+    if (mode != details::notify_mode::none)
+        notify(this, mode, value, old_value);
+
+    notify_depth_guard depth_guard{this};
+    for (std::size_t i = 0; i < subscribers.size(); i++) {
+        details::subscriber sub = subscribers[i];
+        if (sub.mode != details::notify_mode::none)
+            notify(sub.prop, sub.mode, value, old_value);
+    }
+}
+
+BINDABLE_PROPERTIES_INLINE void property_base::remove_empty_slots()
 {
-    // we first change the values of all copies, then we notify them
-    // because one of the notifications may use the value of other
-    // copy of the same property
-    property_base* crawler = this;
-    while (crawler != nullptr) {
-        if (crawler->func)
-            crawler->func(crawler, value,
-                          details::call_type::initial_notification);
-        crawler = crawler->next;
+    std::size_t kept = 0;
+    for (std::size_t i = 0; i < subscribers.size(); i++) {
+        details::subscriber sub = subscribers[i];
+        if (!sub.prop)
+            continue;
+
+        sub.prop->index = static_cast<std::uint32_t>(kept);
+        subscribers[kept++] = sub;
     }
 
-    crawler = this;
-    while (crawler != nullptr) {
-        if (crawler->func)
-            crawler->func(crawler, value, details::call_type::notification);
-        crawler = crawler->next;
+    subscribers.truncate(kept);
+    has_empty_slots = false;
+}
+
+BINDABLE_PROPERTIES_INLINE
+void property_base::notify(property_base* prop, details::notify_mode prop_mode,
+                           void* value, void* old_value)
+{
+    if (prop_mode == details::notify_mode::change) {
+        details::change_record record{value, old_value ? old_value : value};
+        prop->func(prop, &record, details::call_type::change_notification);
+    } else {
+        prop->func(prop, value, details::call_type::notification);
     }
 }
 
-void property_base::update()
+BINDABLE_PROPERTIES_INLINE void property_base::update()
 {
-    if (func) {
+    if (!func)
+        return;
+
+    // the number of writes of this property that are still propagating
+    unsigned depth = 0;
+    for (const property_base* p : details::notifying()) {
+        if (p == this)
+            depth++;
+    }
+
+    if (depth == 0) {
         func(this, nullptr, details::call_type::binding);
+    } else if (depth <= details::cycle_iterations()) {
+        func(this, nullptr, details::call_type::reentrant_binding);
     }
+    // otherwise this update closes a cycle and is dropped
 }
 
-int property_base::num_views() const
+BINDABLE_PROPERTIES_INLINE
+void property_base::set_notify_mode(details::notify_mode new_mode)
+{
+    if (new_mode == mode)
+        return;
+
+    if (owner) {
+        if (mode == details::notify_mode::change)
+            owner->num_old_value_listeners--;
+        if (new_mode == details::notify_mode::change)
+            owner->num_old_value_listeners++;
+        if (!is_owner())
+            owner->subscribers[index].mode = new_mode;
+    }
+    mode = new_mode;
+}
+
+BINDABLE_PROPERTIES_INLINE int property_base::num_views() const
 {
     if (is_zombie())
         return 0;
 
+    const details::subscriber_list& list = owner->subscribers;
+    if (!owner->has_empty_slots)
+        return static_cast<int>(list.size());
+
     int result = 0;
-    property_base* crawler = owner->next;
-    while (crawler != nullptr) {
-        result++;
-        crawler = crawler->next;
+    for (std::size_t i = 0; i < list.size(); i++) {
+        if (list[i].prop)
+            result++;
     }
-
     return result;
 }
 
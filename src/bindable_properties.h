@@ -1,10 +1,20 @@
 #ifndef BINDABLE_PROPERTIES_H
 #define BINDABLE_PROPERTIES_H
 
+#include <cstddef>
+#include <cstdint>
 #include <functional>
+#include <memory>
 #include <type_traits>
+#include <utility>
 #include <vector>
 
+#ifdef BINDABLE_PROPERTIES_HEADER_ONLY
+#    define BINDABLE_PROPERTIES_INLINE inline
+#else
+#    define BINDABLE_PROPERTIES_INLINE
+#endif
+
 namespace bindable_properties
 {
 
@@ -13,6 +23,9 @@ class property_base;
 template <typename T>
 class property;
 
+template <typename T, typename U>
+class property_selector;
+
 namespace details
 {
 #ifdef __cpp_lib_is_invocable
@@ -40,17 +53,123 @@ template <class F, class... Args>
 using invoke_result = std::result_of<F(Args...)>;
 #endif
 
+struct binding_state;
+
 bool is_currently_binding();
 void set_currently_binding(bool);
 void register_property(property_base*);
-void set_current_prop(property_base*);
+std::shared_ptr<binding_state> set_current_prop(property_base*);
+void binding_state_created();
+void binding_state_destroyed();
+bool begin_change_request(const property_base*);
+void end_change_request();
+
+// keeps an owner on the stack of running setters for its lifetime, so that
+// a setter that throws doesn't leave it there
+struct change_request_guard {
+    explicit change_request_guard(const property_base* prop) :
+        active{begin_change_request(prop)}
+    {
+    }
+    ~change_request_guard()
+    {
+        if (active)
+            end_change_request();
+    }
+
+    change_request_guard(const change_request_guard&) = delete;
+    change_request_guard& operator=(const change_request_guard&) = delete;
+
+    bool active;
+};
+
+// while updates are deferred on a thread, the bindings whose dependencies
+// change are collected into the given vector instead of being re-evaluated
+void defer_updates(std::vector<property_base*>* dirty);
+std::vector<property_base*>* deferred_updates();
+void update(property_base* prop);
+void collect_dependents(property_base* prop,
+                        std::vector<property_base*>& dependents);
 
 enum class call_type {
     initial_binding,
     binding,
+    // re-evaluation of a binding that re-enters a property whose previous
+    // write is still being propagated, i.e. a cycle in the binding graph
+    reentrant_binding,
     setter,
-    initial_notification,
-    notification
+    // the owner of a view goes away, the view keeps a copy of the value
+    release,
+    notification,
+    // a notification that also carries the previous value, only sent to
+    // properties that asked for it, see notify_mode::change
+    change_notification,
+    // asks a subscription of a binding to push the bound property into the
+    // std::vector<property_base*> passed as the value
+    dependents
+};
+
+// the value passed along with call_type::change_notification
+struct change_record {
+    void* value;
+    void* old_value;
+};
+
+// which notifications the func of a property wants. Owners skip passive
+// subscribers without touching them
+enum class notify_mode : unsigned char { none, value, change };
+
+struct subscriber {
+    property_base* prop;
+    notify_mode mode;
+};
+
+// the subscribers of an owner, kept contiguous so that notifying them walks
+// memory linearly instead of hopping from view to view. A single subscriber
+// is stored inline, more are stored in an array that only ever grows
+class subscriber_list
+{
+public:
+    subscriber_list() noexcept : count{0}, capacity{1}
+    {
+        storage.local = subscriber{nullptr, notify_mode::none};
+    }
+    ~subscriber_list() { clear(); }
+
+    subscriber_list(const subscriber_list&) = delete;
+    subscriber_list& operator=(const subscriber_list&) = delete;
+
+    std::size_t size() const { return count; }
+
+    subscriber& operator[](std::size_t i) { return data()[i]; }
+    const subscriber& operator[](std::size_t i) const { return data()[i]; }
+
+    void push_back(const subscriber& sub);
+    // moves the last subscriber into slot i
+    void swap_remove(std::size_t i) { data()[i] = data()[--count]; }
+    void truncate(std::size_t new_size)
+    {
+        count = static_cast<std::uint32_t>(new_size);
+    }
+    void clear();
+    void swap(subscriber_list& other) noexcept;
+
+private:
+    subscriber* data()
+    {
+        return capacity > 1 ? storage.heap : &storage.local;
+    }
+    const subscriber* data() const
+    {
+        return capacity > 1 ? storage.heap : &storage.local;
+    }
+
+    union storage_type {
+        subscriber local;
+        subscriber* heap;
+    } storage;
+    std::uint32_t count;
+    std::uint32_t capacity;
 };
 
 template <typename T>
@@ -70,7 +189,7 @@ template <typename T>
 struct default_notifier {
     void operator()(property_base* prop, void* value, call_type type)
     {
-        if (type == call_type::initial_notification) {
+        if (type == call_type::release) {
             property<T>* prop_casted = static_cast<property<T>*>(prop);
             T* value_casted = static_cast<T*>(value);
 
@@ -79,6 +198,30 @@ struct default_notifier {
     }
 };
 
+template <typename T, typename = void>
+struct is_equality_comparable : std::false_type {
+};
+
+template <typename T>
+struct is_equality_comparable<T, decltype(void(std::declval<const T&>() ==
+                                               std::declval<const T&>()))>
+    : std::true_type {
+};
+
+template <typename T>
+typename std::enable_if<is_equality_comparable<T>::value, bool>::type
+equal_values(const T& a, const T& b)
+{
+    return a == b;
+}
+
+template <typename T>
+typename std::enable_if<!is_equality_comparable<T>::value, bool>::type
+equal_values(const T&, const T&)
+{
+    return false;
+}
+
 struct nop {
     template <typename... Args>
     void operator()(Args&&...)
@@ -100,6 +243,12 @@ struct arguments_adapter {
         return apply(prop, value);
     }
 
+    template <typename T>
+    void operator()(property<T>& prop, const T& old_value, const T& value)
+    {
+        return apply_change(prop, old_value, value);
+    }
+
     template <typename T>
     void operator()(property<T>& prop)
     {
@@ -150,9 +299,81 @@ struct arguments_adapter {
         lambda();
     }
 
+    // notifiers that take the previous value as well are only called through
+    // apply_change, this overload exists so that they still compile where the
+    // previous value is not available
+    template <typename T>
+    typename std::enable_if<
+        (details::is_invocable<Lambda, const T&, const T&>::value ||
+         details::is_invocable<Lambda, property_ref<T>, const T&,
+                               const T&>::value) &&
+        !details::is_invocable<Lambda>::value &&
+        !details::is_invocable<Lambda, const T&>::value &&
+        !details::is_invocable<Lambda, property_ref<T>>::value &&
+        !details::is_invocable<Lambda, property_ref<T>, const T&>::value>::type
+    apply(property<T>& prop, const T& value)
+    {
+        apply_change(prop, value, value);
+    }
+
+    template <typename T>
+    typename std::enable_if<details::is_invocable<
+        Lambda, property_ref<T>, const T&, const T&>::value>::type
+    apply_change(property<T>& prop, const T& old_value, const T& value)
+    {
+        lambda(prop, old_value, value);
+    }
+
+    template <typename T>
+    typename std::enable_if<
+        details::is_invocable<Lambda, const T&, const T&>::value &&
+        !details::is_invocable<Lambda, property_ref<T>, const T&,
+                               const T&>::value>::type
+    apply_change(property<T>& /* prop */, const T& old_value, const T& value)
+    {
+        lambda(old_value, value);
+    }
+
+    template <typename T>
+    typename std::enable_if<
+        !details::is_invocable<Lambda, const T&, const T&>::value &&
+        !details::is_invocable<Lambda, property_ref<T>, const T&,
+                               const T&>::value>::type
+    apply_change(property<T>& prop, const T& /* old_value */, const T& value)
+    {
+        apply(prop, value);
+    }
+
     Lambda lambda;
 };
 
+// whether a notifier lambda wants to receive the previous value as well
+template <typename Lambda, typename T>
+struct accepts_old_value
+    : std::integral_constant<
+          bool,
+          details::is_invocable<Lambda, std::reference_wrapper<property<T>>,
+                                const T&, const T&>::value ||
+              details::is_invocable<Lambda, const T&, const T&>::value> {
+};
+
+template <typename T>
+struct accepts_old_value<nop, T> : std::false_type {
+};
+
+// the notifications a property wants, given its notifier lambda
+template <typename Lambda, typename T>
+struct notify_mode_of
+    : std::integral_constant<notify_mode, accepts_old_value<Lambda, T>::value
+                                              ? notify_mode::change
+                                              : notify_mode::value> {
+};
+
+template <typename T>
+struct notify_mode_of<nop, T>
+    : std::integral_constant<notify_mode, notify_mode::none> {
+};
+
 template <typename T, typename BindingLambda, typename SetterLambda,
           typename NotifierLambda>
 struct property_binder {
@@ -169,9 +390,10 @@ struct property_binder {
         switch (type) {
         case call_type::initial_binding: {
             set_currently_binding(true);
-            set_current_prop(prop);
+            state = set_current_prop(prop);
             auto result = binding();
             set_currently_binding(false);
+            set_current_prop(nullptr);
 
             prop_casted->set_directly_as_owner(result);
             break;
@@ -179,6 +401,9 @@ struct property_binder {
         case call_type::binding:
             prop_casted->set_directly_as_owner(binding());
             break;
+        case call_type::reentrant_binding:
+            prop_casted->set_if_changed_as_owner(binding());
+            break;
         case call_type::setter: {
             setter(*prop_casted, *static_cast<T*>(value));
             break;
@@ -186,12 +411,22 @@ struct property_binder {
         case call_type::notification:
             notifier(*prop_casted, prop_casted->value());
             break;
+        case call_type::change_notification:
+            notifier(*prop_casted,
+                     *static_cast<T*>(
+                         static_cast<change_record*>(value)->old_value),
+                     prop_casted->value());
+            break;
         default:
             // this should never happen
             break;
         }
     }
 
+    // the binder owns the state holding the subscriptions to the
+    // dependencies, so they are dropped as soon as the binding is replaced
+    // or the property is destroyed
+    std::shared_ptr<binding_state> state;
     BindingLambda binding;
     arguments_adapter<SetterLambda> setter;
     arguments_adapter<NotifierLambda> notifier;
@@ -207,12 +442,18 @@ struct property_notifier {
         T* value_casted = static_cast<T*>(value);
 
         switch (type) {
-        case call_type::initial_notification:
+        case call_type::release:
             prop_casted->val = *value_casted;
             break;
         case call_type::notification:
             notifier(*prop_casted, *value_casted);
             break;
+        case call_type::change_notification: {
+            change_record* record = static_cast<change_record*>(value);
+            notifier(*prop_casted, *static_cast<T*>(record->old_value),
+                     *static_cast<T*>(record->value));
+            break;
+        }
         case call_type::setter:
             if (prop_casted->is_owner())
                 prop_casted->set_directly_as_owner(*value_casted);
@@ -247,13 +488,91 @@ struct property_setter {
     arguments_adapter<SetterLambda> setter;
 };
 
+// the func of the views through which bindings subscribe to their
+// dependencies, `bound` being a view of the bound property
+struct dependency_subscriber {
+    void operator()(property_base* prop, void* value, call_type type);
+
+    const property_base* bound;
+};
+
+template <typename Expr>
+struct expression_state;
+
+template <typename T, typename Expr, typename SetterLambda,
+          typename NotifierLambda>
+struct expression_binder {
+    expression_binder(std::shared_ptr<expression_state<Expr>> state_,
+                      SetterLambda setter_, NotifierLambda notifier_) :
+        state{std::move(state_)}, setter{setter_}, notifier{notifier_}
+    {
+    }
+
+    void operator()(property_base* prop, void* value, call_type type)
+    {
+        property<T>* prop_casted = static_cast<property<T>*>(prop);
+
+        switch (type) {
+        case call_type::initial_binding:
+        case call_type::binding:
+            prop_casted->set_directly_as_owner(state->expr.eval());
+            break;
+        case call_type::reentrant_binding:
+            prop_casted->set_if_changed_as_owner(state->expr.eval());
+            break;
+        case call_type::setter:
+            setter(*prop_casted, *static_cast<T*>(value));
+            break;
+        case call_type::notification:
+            notifier(*prop_casted, prop_casted->value());
+            break;
+        case call_type::change_notification:
+            notifier(*prop_casted,
+                     *static_cast<T*>(
+                         static_cast<change_record*>(value)->old_value),
+                     prop_casted->value());
+            break;
+        default:
+            // this should never happen
+            break;
+        }
+    }
+
+    std::shared_ptr<expression_state<Expr>> state;
+    arguments_adapter<SetterLambda> setter;
+    arguments_adapter<NotifierLambda> notifier;
+};
+
 } // namespace details
 
+// number of binding states that are currently alive, one per bound
+// property, across all threads
+std::size_t live_binding_states();
+
+// When a write propagates back to a property whose own write is still being
+// propagated, the bindings form a cycle. By default the cycle is cut there:
+// the re-entrant re-evaluation is dropped. For numeric constraints that
+// converge, up to `n` re-entrant re-evaluations per property are allowed
+// instead, and each one only writes if it changes the value, so that the
+// propagation stops at the fixed point. The setting is per thread.
+void set_max_cycle_iterations(unsigned n);
+unsigned max_cycle_iterations();
+
 class property_base
 {
     template <typename T>
     friend class property;
     friend void details::register_property(property_base*);
+    friend void details::update(property_base*);
+    friend void details::collect_dependents(property_base*,
+                                            std::vector<property_base*>&);
+    friend struct details::dependency_subscriber;
+
+    template <typename Expr>
+    friend struct details::expression_state;
+
+    template <typename T, typename U>
+    friend class property_selector;
 
 public:
     property_base() noexcept;
@@ -272,15 +591,41 @@ public:
 protected:
     void attach_to(const property_base& other);
     void detach();
-    void notify_all(void* value);
+    void notify_all(void* value, void* old_value = nullptr);
     void update();
+    void set_notify_mode(details::notify_mode new_mode);
+
+    static void notify(property_base* prop, details::notify_mode prop_mode,
+                       void* value, void* old_value);
+    void remove_empty_slots();
+
+    // counts a notification in notify_depth for its lifetime
+    struct notify_depth_guard;
 
 protected:
     property_base* owner;
-    mutable property_base* next;
-    mutable property_base* prev;
+
+    // the views of an owner, and the properties through which bindings
+    // subscribe to it. Unused by views
+    details::subscriber_list subscribers;
 
     std::function<void(property_base*, void*, details::call_type)> func;
+
+    // for views, their slot in the subscribers of their owner
+    std::uint32_t index;
+
+    // the notifications func wants, and for owners, how many of the
+    // properties attached to them (themselves included) want
+    // call_type::change_notification, so that owners only keep their
+    // previous value around when needed
+    details::notify_mode mode;
+    unsigned num_old_value_listeners;
+
+    // views that detach while their owner is notifying leave an empty slot
+    // behind instead of being swapped out, so that no view is skipped. The
+    // slots are removed once the outermost notification is over
+    std::uint16_t notify_depth;
+    bool has_empty_slots;
 };
 
 template <typename T>
@@ -301,6 +646,10 @@ class property : public property_base
     template <typename U>
     friend struct details::default_notifier;
 
+    template <typename U, typename Expr, typename SetterLambda,
+              typename NotifierLambda>
+    friend struct details::expression_binder;
+
 public:
     using value_type = T;
     using reference = T&;
@@ -321,28 +670,36 @@ public:
         } else {
             func = details::default_notifier<T>{};
         }
+        set_notify_mode(details::notify_mode::none);
     }
 
     property(const self& other) noexcept : property_base(other)
     {
-        val = other.val;
+        val = other.peek();
         func = details::default_notifier<T>();
     }
 
+    ~property() { release_views(); }
+
     self& operator=(const self& other)
     {
+        if (this == &other)
+            return *this;
+
+        release_views();
         property_base::operator=(other);
-        val = other.val;
+        val = other.peek();
         func = details::default_notifier<T>();
+        set_notify_mode(details::notify_mode::none);
 
         return *this;
     }
 
     self& operator=(self&& other)
     {
+        release_views();
         property_base::operator=(std::move(other));
         val = other.val;
-        func = std::move(other.func);
 
         return *this;
     }
@@ -356,14 +713,25 @@ public:
         return *this;
     }
 
-    operator value_type() const { return value(); }
+    operator const_reference() const { return value(); }
 
     const_reference value() const
     {
         if (details::is_currently_binding()) {
             details::register_property(const_cast<self*>(this));
         }
-        return val;
+        return peek();
+    }
+
+    // reads the value without registering it as a dependency of a binding
+    // that is currently being evaluated
+    const_reference peek() const
+    {
+        // views read through to their owner, zombies keep their own copy.
+        // Owners are their own owner, so they take the same path as views
+        // and only pay for one more load, without any comparison
+        const property_base* source = owner ? owner : this;
+        return static_cast<const self*>(source)->val;
     }
 
     void request_change(const_reference val)
@@ -375,9 +743,15 @@ public:
 
     void become_owner()
     {
+        if (is_view())
+            val = owner_casted()->val;
+
+        release_views();
         detach();
         owner = this;
+        num_old_value_listeners = 0;
         func = details::default_setter<T>{};
+        mode = details::notify_mode::none;
     }
 
     template <typename Lambda>
@@ -387,6 +761,7 @@ public:
             return false;
 
         func = details::property_setter<T, decltype(lambda)>{lambda};
+        set_notify_mode(details::notify_mode::none);
 
         return true;
     }
@@ -395,6 +770,7 @@ public:
     bool set_notifier(Lambda lambda)
     {
         func = details::property_notifier<T, decltype(lambda)>{lambda};
+        set_notify_mode(details::notify_mode_of<Lambda, T>::value);
 
         return true;
     }
@@ -411,28 +787,417 @@ public:
         func = details::property_binder<T, BindingLambda, SetterLambda,
                                         NotifierLambda>{
             binding_lambda, setter_lambda, notification_lambda};
+        set_notify_mode(details::notify_mode_of<NotifierLambda, T>::value);
+
+        func(this, nullptr, details::call_type::initial_binding);
+        return true;
+    }
+
+    // binds to an expression built from the operators in
+    // bindable_properties::expressions, e.g. `z.bind(x * 2 + y)`
+    template <typename Expr, typename SetterLambda = details::nop,
+              typename NotifierLambda = details::nop>
+    bool bind(const Expr& expr, SetterLambda setter_lambda = details::nop{},
+              NotifierLambda notification_lambda = details::nop{})
+    {
+        if (!is_owner())
+            return false;
+
+        func = details::expression_binder<T, Expr, SetterLambda,
+                                          NotifierLambda>{
+            std::make_shared<details::expression_state<Expr>>(*this, expr),
+            setter_lambda, notification_lambda};
+        set_notify_mode(details::notify_mode_of<NotifierLambda, T>::value);
 
         func(this, nullptr, details::call_type::initial_binding);
         return true;
     }
 
+    // a property following a single member of the value, e.g.
+    // `auto timeout = config.select(&config_type::timeout)`
+    template <typename U, typename Class>
+    property_selector<T, U> select(U Class::*member) const
+    {
+        return property_selector<T, U>{*this, member};
+    }
+
 private:
     self* owner_casted() { return static_cast<self*>(this->owner); }
 
+    // gives the views of this owner their own copy of the value, before they
+    // are detached from it
+    void release_views()
+    {
+        if (!is_owner())
+            return;
+
+        for (std::size_t i = 0; i < subscribers.size(); i++) {
+            property_base* view = subscribers[i].prop;
+            if (view && view->func)
+                view->func(view, &val, details::call_type::release);
+        }
+    }
+
     void set_using_setter_as_owner(const_reference new_val)
     {
+        // setters that request changes from each other would ping-pong
+        // forever, so a request that comes back to an owner whose setter is
+        // still running is accepted as is
+        details::change_request_guard guard{this};
+        if (!guard.active) {
+            set_if_changed_as_owner(new_val);
+            return;
+        }
+
         func(this, (void*)&new_val, details::call_type::setter);
     }
     void set_directly_as_owner(const_reference new_val)
     {
+        if (num_old_value_listeners == 0 ||
+            std::addressof(new_val) == std::addressof(val)) {
+            val = new_val;
+            notify_all(&val);
+            return;
+        }
+
+        // the previous value is only kept alive while the notifications run
+        T old_val = std::move(val);
         val = new_val;
-        notify_all(&val);
+        notify_all(&val, &old_val);
+    }
+    void set_if_changed_as_owner(const_reference new_val)
+    {
+        if (!details::equal_values(val, new_val))
+            set_directly_as_owner(new_val);
     }
 
 private:
     T val;
 };
 
+// Follows one member of the value of a property. The selector only changes,
+// and only notifies its notifier, views and the bindings that read it, when
+// the selected member changes, so that they ignore writes to other members.
+//
+// The selector compares the member on every write of the source, and keeps
+// its own copy of the member only, rather than of the whole value. It stops
+// following the source when the source is destroyed.
+template <typename T, typename U>
+class property_selector
+{
+public:
+    property_selector(const property<T>& source, U T::*member_) :
+        member{member_}, field{source.peek().*member_}, subscription{source}
+    {
+        subscribe();
+    }
+
+    // the field is move assigned rather than move constructed, since only
+    // the move assignment of a property keeps its notifier
+    property_selector(property_selector&& other) noexcept :
+        member{other.member}, field{other.field.peek()},
+        subscription{other.subscription}
+    {
+        field = std::move(other.field);
+        subscribe();
+        other.subscription.detach();
+    }
+
+    property_selector& operator=(property_selector&& other) noexcept
+    {
+        if (this == &other)
+            return *this;
+
+        member = other.member;
+        field = std::move(other.field);
+        subscription = other.subscription;
+        subscribe();
+        other.subscription.detach();
+
+        return *this;
+    }
+
+    property_selector(const property_selector&) = delete;
+    property_selector& operator=(const property_selector&) = delete;
+
+    // registers the selected member, rather than the whole source, as a
+    // dependency of the binding currently being evaluated
+    const U& value() const { return field.value(); }
+    const U& peek() const { return field.peek(); }
+    operator const U&() const { return value(); }
+
+    // the selected member as a property, to take views of
+    const property<U>& as_property() const { return field; }
+
+    template <typename Lambda>
+    bool set_notifier(Lambda lambda)
+    {
+        return field.set_notifier(lambda);
+    }
+
+    // requests the source to change to its current value with the selected
+    // member replaced
+    void request_change(const U& new_val)
+    {
+        if (subscription.is_zombie())
+            return;
+
+        property<T>* source = static_cast<property<T>*>(subscription.owner);
+        T value = source->peek();
+        value.*member = new_val;
+        source->request_change(value);
+    }
+
+private:
+    void subscribe()
+    {
+        subscription.func = [this](property_base*, void* value,
+                                   details::call_type type) {
+            if (type != details::call_type::notification)
+                return;
+
+            const U& selected = static_cast<const T*>(value)->*member;
+            if (!details::equal_values(field.peek(), selected))
+                field = selected;
+        };
+        subscription.set_notify_mode(details::notify_mode::value);
+    }
+
+    U T::*member;
+    property<U> field;
+    property_base subscription;
+};
+
+namespace details
+{
+
+// the dependencies of an expression are known from its type, so they are
+// subscribed to directly instead of being discovered while evaluating it
+template <typename Expr>
+struct expression_state {
+    static constexpr std::size_t num_deps =
+        Expr::num_leaves > 0 ? Expr::num_leaves : 1;
+
+    expression_state(const property_base& prop_, const Expr& expr_) :
+        prop{prop_}, expr{expr_}, num_subscribed{0}
+    {
+        binding_state_created();
+        expr.for_each_leaf(*this);
+    }
+
+    expression_state(const expression_state&) = delete;
+    expression_state& operator=(const expression_state&) = delete;
+
+    ~expression_state() { binding_state_destroyed(); }
+
+    void operator()(const property_base& leaf)
+    {
+        // an expression such as `x * x` only subscribes to x once
+        for (std::size_t i = 0; i < num_subscribed; i++) {
+            if (deps[i].owner == leaf.owner)
+                return;
+        }
+
+        property_base& dep = deps[num_subscribed++];
+        dep = leaf;
+
+        dep.func = dependency_subscriber{&prop};
+        dep.set_notify_mode(notify_mode::value);
+    }
+
+    property_base prop;
+    property_base deps[num_deps];
+    Expr expr;
+    std::size_t num_subscribed;
+};
+
+} // namespace details
+
+// Operators on properties that build typed expression trees instead of
+// computing a value. They are opt-in, since they would otherwise hijack
+// expressions such as `std::sqrt(x * x + y * y)` that rely on the implicit
+// conversion of properties to their values:
+//
+//     using namespace bindable_properties::expressions;
+//     z.bind(x * 2 + y);
+namespace expressions
+{
+
+template <typename T>
+struct leaf {
+    using value_type = T;
+    static constexpr std::size_t num_leaves = 1;
+
+    const T& eval() const { return prop->peek(); }
+
+    template <typename F>
+    void for_each_leaf(F& f) const
+    {
+        f(*prop);
+    }
+
+    const property<T>* prop;
+};
+
+template <typename T>
+struct constant {
+    using value_type = T;
+    static constexpr std::size_t num_leaves = 0;
+
+    const T& eval() const { return val; }
+
+    template <typename F>
+    void for_each_leaf(F&) const
+    {
+    }
+
+    T val;
+};
+
+template <typename Op, typename E>
+struct unary_expression {
+    using value_type = typename std::decay<decltype(std::declval<Op>()(
+        std::declval<const E&>().eval()))>::type;
+    static constexpr std::size_t num_leaves = E::num_leaves;
+
+    value_type eval() const { return Op{}(e.eval()); }
+
+    template <typename F>
+    void for_each_leaf(F& f) const
+    {
+        e.for_each_leaf(f);
+    }
+
+    E e;
+};
+
+template <typename Op, typename L, typename R>
+struct binary_expression {
+    using value_type = typename std::decay<decltype(std::declval<Op>()(
+        std::declval<const L&>().eval(),
+        std::declval<const R&>().eval()))>::type;
+    static constexpr std::size_t num_leaves = L::num_leaves + R::num_leaves;
+
+    value_type eval() const { return Op{}(l.eval(), r.eval()); }
+
+    template <typename F>
+    void for_each_leaf(F& f) const
+    {
+        l.for_each_leaf(f);
+        r.for_each_leaf(f);
+    }
+
+    L l;
+    R r;
+};
+
+template <typename T>
+struct is_operand : std::false_type {
+};
+
+template <typename T>
+struct is_operand<property<T>> : std::true_type {
+};
+
+template <typename Op, typename E>
+struct is_operand<unary_expression<Op, E>> : std::true_type {
+};
+
+template <typename Op, typename L, typename R>
+struct is_operand<binary_expression<Op, L, R>> : std::true_type {
+};
+
+template <typename T>
+struct to_expression {
+    using type = constant<T>;
+    static type make(const T& val) { return type{val}; }
+};
+
+template <typename T>
+struct to_expression<property<T>> {
+    using type = leaf<T>;
+    static type make(const property<T>& prop) { return type{&prop}; }
+};
+
+template <typename Op, typename E>
+struct to_expression<unary_expression<Op, E>> {
+    using type = unary_expression<Op, E>;
+    static const type& make(const type& expr) { return expr; }
+};
+
+template <typename Op, typename L, typename R>
+struct to_expression<binary_expression<Op, L, R>> {
+    using type = binary_expression<Op, L, R>;
+    static const type& make(const type& expr) { return expr; }
+};
+
+template <typename Op, typename L, typename R>
+using binary_result = typename std::enable_if<
+    is_operand<L>::value || is_operand<R>::value,
+    binary_expression<Op, typename to_expression<L>::type,
+                      typename to_expression<R>::type>>::type;
+
+template <typename Op, typename E>
+using unary_result =
+    typename std::enable_if<is_operand<E>::value,
+                            unary_expression<Op, typename to_expression<
+                                                     E>::type>>::type;
+
+#define BINDABLE_PROPERTIES_BINARY_OPERATOR(NAME, OP)                          \
+    struct NAME {                                                              \
+        template <typename A, typename B>                                      \
+        auto operator()(const A& a, const B& b) const -> decltype(a OP b)      \
+        {                                                                      \
+            return a OP b;                                                     \
+        }                                                                      \
+    };                                                                         \
+                                                                               \
+    template <typename L, typename R>                                          \
+    binary_result<NAME, L, R> operator OP(const L& l, const R& r)              \
+    {                                                                          \
+        return {to_expression<L>::make(l), to_expression<R>::make(r)};         \
+    }
+
+#define BINDABLE_PROPERTIES_UNARY_OPERATOR(NAME, OP)                           \
+    struct NAME {                                                              \
+        template <typename A>                                                  \
+        auto operator()(const A& a) const -> decltype(OP a)                    \
+        {                                                                      \
+            return OP a;                                                       \
+        }                                                                      \
+    };                                                                         \
+                                                                               \
+    template <typename E>                                                      \
+    unary_result<NAME, E> operator OP(const E& e)                              \
+    {                                                                          \
+        return {to_expression<E>::make(e)};                                    \
+    }
+
+BINDABLE_PROPERTIES_BINARY_OPERATOR(plus, +)
+BINDABLE_PROPERTIES_BINARY_OPERATOR(minus, -)
+BINDABLE_PROPERTIES_BINARY_OPERATOR(multiplies, *)
+BINDABLE_PROPERTIES_BINARY_OPERATOR(divides, /)
+BINDABLE_PROPERTIES_BINARY_OPERATOR(modulus, %)
+BINDABLE_PROPERTIES_BINARY_OPERATOR(equal_to, ==)
+BINDABLE_PROPERTIES_BINARY_OPERATOR(not_equal_to, !=)
+BINDABLE_PROPERTIES_BINARY_OPERATOR(less, <)
+BINDABLE_PROPERTIES_BINARY_OPERATOR(less_equal, <=)
+BINDABLE_PROPERTIES_BINARY_OPERATOR(greater, >)
+BINDABLE_PROPERTIES_BINARY_OPERATOR(greater_equal, >=)
+BINDABLE_PROPERTIES_BINARY_OPERATOR(logical_and, &&)
+BINDABLE_PROPERTIES_BINARY_OPERATOR(logical_or, ||)
+BINDABLE_PROPERTIES_UNARY_OPERATOR(negate, -)
+BINDABLE_PROPERTIES_UNARY_OPERATOR(logical_not, !)
+
+#undef BINDABLE_PROPERTIES_BINARY_OPERATOR
+#undef BINDABLE_PROPERTIES_UNARY_OPERATOR
+
+} // namespace expressions
+
 } // namespace bindable_properties
 
+#ifdef BINDABLE_PROPERTIES_HEADER_ONLY
+#    include "bindable_properties.cpp"
+#endif
+
 #endif // BINDABLE_PROPERTIES_H
@@ -0,0 +1,320 @@
+#include "parallel_propagation.h"
+
+#include <unordered_map>
+
+namespace bindable_properties
+{
+
+BINDABLE_PROPERTIES_INLINE thread_pool::thread_pool(unsigned num_threads) :
+    task{nullptr}, remaining{0}, failed{false}, generation{0}, num_active{0},
+    stopping{false}
+{
+    if (num_threads == 0)
+        num_threads = 1;
+
+    for (unsigned i = 0; i < num_threads; i++)
+        queues.emplace_back(new worker_queue);
+
+    for (unsigned i = 1; i < num_threads; i++)
+        workers.emplace_back([this, i]() { worker_loop(i); });
+}
+
+BINDABLE_PROPERTIES_INLINE thread_pool::~thread_pool()
+{
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        stopping = true;
+    }
+    work_available.notify_all();
+
+    for (std::thread& worker : workers)
+        worker.join();
+}
+
+BINDABLE_PROPERTIES_INLINE unsigned thread_pool::num_threads() const
+{
+    return static_cast<unsigned>(queues.size());
+}
+
+BINDABLE_PROPERTIES_INLINE void thread_pool::parallel_for(
+    std::size_t count, const std::function<void(std::size_t, unsigned)>& task_)
+{
+    // the calling thread always runs as thread 0, so even the inline path
+    // must not overlap with another caller
+    std::lock_guard<std::mutex> call_lock{call_mutex};
+
+    if (workers.empty() || count < 2) {
+        for (std::size_t i = 0; i < count; i++)
+            task_(i, 0);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        task = &task_;
+        remaining = count;
+
+        for (std::size_t i = 0; i < count; i++) {
+            worker_queue& queue = *queues[i % queues.size()];
+            std::lock_guard<std::mutex> queue_lock{queue.mutex};
+            queue.indices.push_back(i);
+        }
+        generation++;
+    }
+    work_available.notify_all();
+
+    run_tasks(0);
+
+    std::unique_lock<std::mutex> lock{mutex};
+    work_done.wait(lock,
+                   [this]() { return remaining == 0 && num_active == 0; });
+    task = nullptr;
+
+    // no thread touches the task anymore, so the exception can leave the
+    // call, along with the task it came from
+    std::exception_ptr first_error;
+    first_error.swap(error);
+    failed = false;
+    lock.unlock();
+
+    if (first_error)
+        std::rethrow_exception(first_error);
+}
+
+BINDABLE_PROPERTIES_INLINE void thread_pool::worker_loop(unsigned thread)
+{
+    std::size_t seen_generation = 0;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock{mutex};
+            work_available.wait(lock, [&]() {
+                return stopping || generation != seen_generation;
+            });
+            if (stopping)
+                return;
+
+            seen_generation = generation;
+            num_active++;
+        }
+
+        run_tasks(thread);
+
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            num_active--;
+        }
+        work_done.notify_all();
+    }
+}
+
+BINDABLE_PROPERTIES_INLINE void thread_pool::run_tasks(unsigned thread)
+{
+    std::size_t index;
+    while (pop_task(thread, index)) {
+        // the queues are still drained after a failure, so that the caller
+        // knows when no thread uses the task anymore
+        if (!failed) {
+            try {
+                (*task)(index, thread);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock{mutex};
+                if (!error)
+                    error = std::current_exception();
+                failed = true;
+            }
+        }
+        remaining--;
+    }
+}
+
+BINDABLE_PROPERTIES_INLINE
+bool thread_pool::pop_task(unsigned thread, std::size_t& index)
+{
+    // take from the back of our own queue, and steal from the front of the
+    // others once it's empty
+    for (std::size_t i = 0; i < queues.size(); i++) {
+        worker_queue& queue = *queues[(thread + i) % queues.size()];
+        std::lock_guard<std::mutex> lock{queue.mutex};
+
+        if (queue.indices.empty())
+            continue;
+
+        if (i == 0) {
+            index = queue.indices.back();
+            queue.indices.pop_back();
+        } else {
+            index = queue.indices.front();
+            queue.indices.pop_front();
+        }
+        return true;
+    }
+
+    return false;
+}
+
+BINDABLE_PROPERTIES_INLINE propagation_batch::propagation_batch() :
+    pool{nullptr}, outermost{details::deferred_updates() == nullptr}
+{
+    if (outermost)
+        details::defer_updates(&dirty);
+}
+
+BINDABLE_PROPERTIES_INLINE
+propagation_batch::propagation_batch(thread_pool& pool_) : propagation_batch()
+{
+    pool = &pool_;
+}
+
+BINDABLE_PROPERTIES_INLINE propagation_batch::~propagation_batch()
+{
+    if (!outermost)
+        return;
+
+    try {
+        flush();
+    } catch (...) {
+        // see the class comment, flush() reports this to callers that want it
+    }
+    details::defer_updates(nullptr);
+}
+
+BINDABLE_PROPERTIES_INLINE void propagation_batch::flush()
+{
+    if (!outermost)
+        return;
+
+    std::vector<property_base*> roots;
+    roots.swap(dirty);
+    details::propagate(roots, pool);
+}
+
+namespace details
+{
+
+// records the updates of the calling thread into dirty for its lifetime, and
+// restores the previous recording also when an update throws
+struct deferred_updates_guard {
+    explicit deferred_updates_guard(std::vector<property_base*>* dirty) :
+        previous{deferred_updates()}
+    {
+        defer_updates(dirty);
+    }
+    ~deferred_updates_guard() { defer_updates(previous); }
+
+    deferred_updates_guard(const deferred_updates_guard&) = delete;
+    deferred_updates_guard& operator=(const deferred_updates_guard&) = delete;
+
+    std::vector<property_base*>* previous;
+};
+
+BINDABLE_PROPERTIES_INLINE
+void propagate(const std::vector<property_base*>& roots, thread_pool* pool)
+{
+    // the affected part of the binding graph
+    std::unordered_map<property_base*, std::size_t> indices;
+    std::vector<property_base*> nodes;
+    std::vector<std::vector<std::size_t>> edges;
+    std::vector<std::size_t> num_inputs;
+
+    auto node_index = [&](property_base* prop) {
+        auto it = indices.find(prop);
+        if (it != indices.end())
+            return it->second;
+
+        indices.emplace(prop, nodes.size());
+        nodes.push_back(prop);
+        edges.emplace_back();
+        num_inputs.push_back(0);
+        return nodes.size() - 1;
+    };
+
+    for (property_base* root : roots)
+        node_index(root);
+
+    std::vector<property_base*> dependents;
+    for (std::size_t i = 0; i < nodes.size(); i++) {
+        dependents.clear();
+        collect_dependents(nodes[i], dependents);
+
+        for (property_base* dependent : dependents) {
+            std::size_t j = node_index(dependent);
+            edges[i].push_back(j);
+            num_inputs[j]++;
+        }
+    }
+
+    // sort the nodes into levels, every node coming after all its inputs
+    static constexpr std::size_t unleveled = static_cast<std::size_t>(-1);
+    std::vector<std::size_t> node_levels(nodes.size(), unleveled);
+    std::vector<std::vector<property_base*>> levels;
+    std::vector<std::size_t> current;
+
+    for (std::size_t i = 0; i < nodes.size(); i++) {
+        if (num_inputs[i] == 0)
+            current.push_back(i);
+    }
+
+    while (!current.empty()) {
+        std::vector<std::size_t> next;
+        levels.emplace_back();
+
+        for (std::size_t i : current) {
+            node_levels[i] = levels.size() - 1;
+            levels.back().push_back(nodes[i]);
+
+            for (std::size_t j : edges[i]) {
+                if (--num_inputs[j] == 0)
+                    next.push_back(j);
+            }
+        }
+        current.swap(next);
+    }
+
+    // updates triggered while evaluating a level are recorded per thread.
+    // Those of the dependents of the evaluated bindings are already planned,
+    // the others come from notifiers writing to other properties
+    unsigned num_threads = pool ? pool->num_threads() : 1;
+    std::vector<std::vector<property_base*>> recorded(num_threads);
+    std::vector<property_base*> leftovers;
+
+    for (std::size_t level = 0; level < levels.size(); level++) {
+        const std::vector<property_base*>& props = levels[level];
+
+        auto evaluate = [&](std::size_t index, unsigned thread) {
+            deferred_updates_guard guard{&recorded[thread]};
+            update(props[index]);
+        };
+
+        if (pool) {
+            pool->parallel_for(props.size(), evaluate);
+        } else {
+            for (std::size_t i = 0; i < props.size(); i++)
+                evaluate(i, 0);
+        }
+
+        for (std::vector<property_base*>& writes : recorded) {
+            for (property_base* prop : writes) {
+                auto it = indices.find(prop);
+                if (it == indices.end() || node_levels[it->second] <= level)
+                    leftovers.push_back(prop);
+            }
+            writes.clear();
+        }
+    }
+
+    // bindings in cycles never got a level. They and the leftovers are
+    // updated like outside of a batch, which also cuts the cycles
+    deferred_updates_guard guard{nullptr};
+
+    for (std::size_t i = 0; i < nodes.size(); i++) {
+        if (node_levels[i] == unleveled)
+            update(nodes[i]);
+    }
+    for (property_base* prop : leftovers)
+        update(prop);
+}
+
+} // namespace details
+
+} // namespace bindable_properties
@@ -0,0 +1,118 @@
+#ifndef PARALLEL_PROPAGATION_H
+#define PARALLEL_PROPAGATION_H
+
+#include "bindable_properties.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace bindable_properties
+{
+
+// A work-stealing thread pool, used to re-evaluate independent bindings
+// concurrently. `num_threads` counts the calling thread, which takes part in
+// the work as well, so a pool of one thread runs everything inline.
+class thread_pool
+{
+public:
+    explicit thread_pool(unsigned num_threads);
+    ~thread_pool();
+
+    thread_pool(const thread_pool&) = delete;
+    thread_pool& operator=(const thread_pool&) = delete;
+
+    unsigned num_threads() const;
+
+    // calls task(index, thread) for every index in [0, count), thread being
+    // in [0, num_threads()), and returns once all the calls returned.
+    // A pool runs one batch of tasks at a time: concurrent callers wait for
+    // each other, so tasks must not call parallel_for on their own pool.
+    // If tasks throw, the remaining ones are skipped and the first exception
+    // is rethrown once all the threads are done with the batch
+    void parallel_for(std::size_t count,
+                      const std::function<void(std::size_t, unsigned)>& task);
+
+private:
+    struct worker_queue {
+        std::mutex mutex;
+        std::deque<std::size_t> indices;
+    };
+
+    void worker_loop(unsigned thread);
+    void run_tasks(unsigned thread);
+    bool pop_task(unsigned thread, std::size_t& index);
+
+    std::vector<std::thread> workers;
+    std::vector<std::unique_ptr<worker_queue>> queues;
+
+    // held by the caller of parallel_for for the whole call
+    std::mutex call_mutex;
+    std::mutex mutex;
+    std::condition_variable work_available;
+    std::condition_variable work_done;
+    const std::function<void(std::size_t, unsigned)>* task;
+    std::atomic<std::size_t> remaining;
+    std::atomic<bool> failed;
+    std::exception_ptr error;
+    std::size_t generation;
+    unsigned num_active;
+    bool stopping;
+};
+
+// Defers the re-evaluation of bindings during its lifetime. Writes still
+// update views and call notifiers right away, but the bindings that depend on
+// the written properties are only re-evaluated when the outermost batch ends.
+//
+// At that point the bindings that need re-evaluation are sorted into
+// topological levels, so that every binding is evaluated after all of its
+// inputs, and the bindings of a level are evaluated concurrently on the given
+// pool. Without a pool, they are evaluated on the calling thread.
+//
+// Bindings and notifiers of the re-evaluated properties run on the threads of
+// the pool, and properties must not be moved or destroyed while a batch is
+// pending. Bindings that form cycles are re-evaluated one after the other at
+// the end, like outside of a batch.
+//
+// A binding or notifier that throws while the batch ends aborts the rest of
+// the propagation. Destructors can't report that, so call flush() before the
+// batch goes out of scope to receive the exception; otherwise it is dropped.
+class propagation_batch
+{
+public:
+    propagation_batch();
+    explicit propagation_batch(thread_pool& pool);
+    ~propagation_batch();
+
+    propagation_batch(const propagation_batch&) = delete;
+    propagation_batch& operator=(const propagation_batch&) = delete;
+
+    // re-evaluates the bindings affected by the writes made so far, and
+    // rethrows the first exception thrown while doing so
+    void flush();
+
+private:
+    thread_pool* pool;
+    bool outermost;
+    std::vector<property_base*> dirty;
+};
+
+namespace details
+{
+void propagate(const std::vector<property_base*>& roots, thread_pool* pool);
+} // namespace details
+
+} // namespace bindable_properties
+
+#ifdef BINDABLE_PROPERTIES_HEADER_ONLY
+#    include "parallel_propagation.cpp"
+#endif
+
+#endif // PARALLEL_PROPAGATION_H
@@ -0,0 +1,177 @@
+#ifndef PROPERTY_STORE_H
+#define PROPERTY_STORE_H
+
+#include "bindable_properties.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace bindable_properties
+{
+
+// A small, trivially copyable reference to a property living in a
+// property_store. Handles stay valid however often they are copied or
+// relocated, and a handle to a destroyed property is detected rather than
+// dangling, since its slot's generation changed.
+struct property_handle {
+    std::uint32_t index;
+    std::uint32_t generation;
+
+    bool operator==(const property_handle& other) const
+    {
+        return index == other.index && generation == other.generation;
+    }
+    bool operator!=(const property_handle& other) const
+    {
+        return !(*this == other);
+    }
+};
+
+// Keeps properties at stable addresses, in chunks of ChunkSize properties
+// each, and hands out handles to them. Containers of handles can grow and
+// shuffle their elements without moving the properties themselves, so views
+// are never relinked. Freed slots are reused before a new chunk is allocated,
+// which keeps the properties dense.
+template <typename T, std::size_t ChunkSize = 64>
+class property_store
+{
+    static_assert(ChunkSize > 0, "chunks must hold at least one property");
+
+public:
+    using handle = property_handle;
+
+    property_store() : num_alive{0}, free_head{no_slot} {}
+
+    ~property_store()
+    {
+        for (std::size_t i = 0; i < capacity(); i++) {
+            slot& s = slot_at(i);
+            if (s.alive)
+                s.prop()->~property<T>();
+        }
+    }
+
+    property_store(const property_store&) = delete;
+    property_store& operator=(const property_store&) = delete;
+
+    // constructs a property<T> from args, like an owner from a value or a
+    // view from another property
+    template <typename... Args>
+    handle create(Args&&... args)
+    {
+        if (free_head == no_slot)
+            add_chunk();
+
+        std::uint32_t index = free_head;
+        slot& s = slot_at(index);
+
+        new (&s.storage) property<T>(std::forward<Args>(args)...);
+        free_head = s.next_free;
+        s.alive = true;
+        num_alive++;
+
+        return {index, s.generation};
+    }
+
+    // returns false if the handle was already stale
+    bool destroy(handle h)
+    {
+        if (!valid(h))
+            return false;
+
+        slot& s = slot_at(h.index);
+        s.prop()->~property<T>();
+        s.alive = false;
+        num_alive--;
+
+        // a slot whose generation wraps around is retired rather than
+        // reused, so that neither zero initialized handles nor handles from
+        // a previous round of generations become valid again
+        if (++s.generation == 0)
+            return true;
+
+        s.next_free = free_head;
+        free_head = h.index;
+
+        return true;
+    }
+
+    bool valid(handle h) const
+    {
+        if (h.index >= capacity())
+            return false;
+
+        const slot& s = slot_at(h.index);
+        return s.alive && s.generation == h.generation;
+    }
+
+    // returns nullptr for stale handles
+    property<T>* get(handle h)
+    {
+        return valid(h) ? slot_at(h.index).prop() : nullptr;
+    }
+
+    const property<T>* get(handle h) const
+    {
+        return valid(h) ? slot_at(h.index).prop() : nullptr;
+    }
+
+    std::size_t size() const { return num_alive; }
+    std::size_t capacity() const { return chunks.size() * ChunkSize; }
+
+private:
+    static constexpr std::uint32_t no_slot = static_cast<std::uint32_t>(-1);
+
+    struct slot {
+        typename std::aligned_storage<sizeof(property<T>),
+                                      alignof(property<T>)>::type storage;
+        // starts at 1, so that a zero initialized handle is never valid
+        std::uint32_t generation = 1;
+        std::uint32_t next_free = no_slot;
+        bool alive = false;
+
+        property<T>* prop() { return reinterpret_cast<property<T>*>(&storage); }
+        const property<T>* prop() const
+        {
+            return reinterpret_cast<const property<T>*>(&storage);
+        }
+    };
+
+    slot& slot_at(std::size_t index)
+    {
+        return chunks[index / ChunkSize][index % ChunkSize];
+    }
+    const slot& slot_at(std::size_t index) const
+    {
+        return chunks[index / ChunkSize][index % ChunkSize];
+    }
+
+    void add_chunk()
+    {
+        std::uint32_t first = static_cast<std::uint32_t>(capacity());
+        chunks.emplace_back(new slot[ChunkSize]);
+
+        // thread the new slots onto the free list in order
+        for (std::size_t i = ChunkSize; i > 0; i--) {
+            slot& s = chunks.back()[i - 1];
+            s.next_free = free_head;
+            free_head = first + static_cast<std::uint32_t>(i - 1);
+        }
+    }
+
+    std::vector<std::unique_ptr<slot[]>> chunks;
+    std::size_t num_alive;
+    std::uint32_t free_head;
+};
+
+template <typename T, std::size_t ChunkSize>
+constexpr std::uint32_t property_store<T, ChunkSize>::no_slot;
+
+} // namespace bindable_properties
+
+#endif // PROPERTY_STORE_H
@@ -0,0 +1,342 @@
+#ifndef SHM_PROPERTY_H
+#define SHM_PROPERTY_H
+
+#include "bindable_properties.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <string>
+#include <thread>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#    include <cerrno>
+#    include <climits>
+#    include <ctime>
+#    include <linux/futex.h>
+#    include <sys/syscall.h>
+#endif
+
+// Mirrors the value of a property into POSIX shared memory, so that other
+// processes on the same host can read it without any marshalling.
+//
+// The publisher subscribes to the property and copies every write into the
+// segment under a seqlock. Readers never block the publisher and never see a
+// torn value, and can wait for changes, using a futex on Linux and polling
+// elsewhere. A segment has a single publisher, and publishing to an existing
+// segment fails rather than reinitializing it under its readers.
+namespace bindable_properties
+{
+namespace details
+{
+
+template <typename T>
+struct shm_segment {
+    static constexpr std::size_t num_words =
+        (sizeof(T) + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t);
+    // "bpsh", stored once the segment is initialized
+    static constexpr std::uint32_t magic = 0x62707368;
+
+    // lets readers reject segments that are not initialized yet, or that
+    // were created for a value of another size
+    std::atomic<std::uint32_t> tag;
+    std::uint32_t value_size;
+    // odd while a write is in progress
+    std::atomic<std::uint32_t> sequence;
+    std::atomic<std::uint32_t> num_waiters;
+    // the value is copied word by word with relaxed atomics, so that
+    // concurrent reads are not data races
+    std::atomic<std::uint64_t> words[num_words];
+};
+
+template <typename T>
+constexpr std::uint32_t shm_segment<T>::magic;
+
+// creates a new segment, failing if one with that name already exists
+template <typename T>
+shm_segment<T>* create_segment(const std::string& name)
+{
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd == -1)
+        return nullptr;
+
+    void* memory = MAP_FAILED;
+    if (ftruncate(fd, sizeof(shm_segment<T>)) != -1)
+        memory = mmap(nullptr, sizeof(shm_segment<T>), PROT_READ | PROT_WRITE,
+                      MAP_SHARED, fd, 0);
+    ::close(fd);
+
+    if (memory == MAP_FAILED) {
+        shm_unlink(name.c_str());
+        return nullptr;
+    }
+
+    shm_segment<T>* segment = new (memory) shm_segment<T>{};
+    segment->value_size = sizeof(T);
+    segment->tag.store(shm_segment<T>::magic, std::memory_order_release);
+    return segment;
+}
+
+// maps an existing segment, failing if it doesn't hold a T
+template <typename T>
+shm_segment<T>* open_segment(const std::string& name)
+{
+    int fd = shm_open(name.c_str(), O_RDWR, 0);
+    if (fd == -1)
+        return nullptr;
+
+    struct stat info;
+    if (fstat(fd, &info) == -1 ||
+        static_cast<std::size_t>(info.st_size) < sizeof(shm_segment<T>)) {
+        ::close(fd);
+        return nullptr;
+    }
+
+    void* memory = mmap(nullptr, sizeof(shm_segment<T>),
+                        PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+
+    if (memory == MAP_FAILED)
+        return nullptr;
+
+    auto* segment = static_cast<shm_segment<T>*>(memory);
+    if (segment->tag.load(std::memory_order_acquire) !=
+            shm_segment<T>::magic ||
+        segment->value_size != sizeof(T)) {
+        munmap(memory, sizeof(shm_segment<T>));
+        return nullptr;
+    }
+
+    return segment;
+}
+
+template <typename T>
+void unmap_segment(shm_segment<T>* segment)
+{
+    munmap(segment, sizeof(shm_segment<T>));
+}
+
+inline void wake_waiters(std::atomic<std::uint32_t>* word)
+{
+#ifdef __linux__
+    syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(word), FUTEX_WAKE,
+            INT_MAX, nullptr, nullptr, 0);
+#else
+    (void)word;
+#endif
+}
+
+// returns false once the deadline is reached
+inline bool wait_on(std::atomic<std::uint32_t>* word, std::uint32_t value,
+                    std::chrono::steady_clock::time_point deadline)
+{
+    auto now = std::chrono::steady_clock::now();
+    if (now >= deadline)
+        return false;
+
+#ifdef __linux__
+    auto remaining =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - now);
+
+    timespec timeout;
+    timeout.tv_sec = static_cast<time_t>(remaining.count() / 1000000000);
+    timeout.tv_nsec = static_cast<long>(remaining.count() % 1000000000);
+
+    // the segment is shared between processes, so no FUTEX_PRIVATE_FLAG
+    if (syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(word), FUTEX_WAIT,
+                value, &timeout, nullptr, 0) == -1 &&
+        errno == ETIMEDOUT)
+        return false;
+#else
+    (void)word;
+    (void)value;
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+#endif
+
+    return true;
+}
+
+} // namespace details
+
+template <typename T>
+class shm_publisher
+{
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "shared memory properties must be trivially copyable");
+    static_assert(ATOMIC_INT_LOCK_FREE == 2 && ATOMIC_LLONG_LOCK_FREE == 2,
+                  "shared memory properties need lock-free atomics, since "
+                  "locks can't be shared with other processes");
+
+public:
+    shm_publisher() : segment{nullptr} {}
+    ~shm_publisher() { close(); }
+
+    shm_publisher(const shm_publisher&) = delete;
+    shm_publisher& operator=(const shm_publisher&) = delete;
+
+    // creates the shared memory segment `name` (such as "/my_property"),
+    // and mirrors the current and all future values of prop into it. Fails if
+    // the segment already exists, such as when another publisher has it open
+    bool open(const std::string& name_, const property<T>& prop)
+    {
+        close();
+
+        segment = details::create_segment<T>(name_);
+        if (!segment)
+            return false;
+
+        name = name_;
+        view = prop;
+        view.set_notifier([this](const T& value) { publish(value); });
+        publish(view.peek());
+
+        return true;
+    }
+
+    bool is_open() const { return segment != nullptr; }
+
+    // stops mirroring, and removes the segment
+    void close()
+    {
+        if (!segment)
+            return;
+
+        view.become_owner();
+        details::unmap_segment(segment);
+        shm_unlink(name.c_str());
+        segment = nullptr;
+    }
+
+private:
+    void publish(const T& value)
+    {
+        std::uint64_t buffer[details::shm_segment<T>::num_words] = {};
+        std::memcpy(buffer, &value, sizeof(T));
+
+        std::uint32_t sequence =
+            segment->sequence.load(std::memory_order_relaxed);
+        segment->sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        for (std::size_t i = 0; i < details::shm_segment<T>::num_words; i++)
+            segment->words[i].store(buffer[i], std::memory_order_relaxed);
+
+        segment->sequence.store(sequence + 2, std::memory_order_seq_cst);
+
+        if (segment->num_waiters.load(std::memory_order_seq_cst) > 0)
+            details::wake_waiters(&segment->sequence);
+    }
+
+    details::shm_segment<T>* segment;
+    std::string name;
+    property<T> view;
+};
+
+template <typename T>
+class shm_reader
+{
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "shared memory properties must be trivially copyable");
+    static_assert(ATOMIC_INT_LOCK_FREE == 2 && ATOMIC_LLONG_LOCK_FREE == 2,
+                  "shared memory properties need lock-free atomics, since "
+                  "locks can't be shared with other processes");
+
+public:
+    shm_reader() : segment{nullptr} {}
+    ~shm_reader() { close(); }
+
+    shm_reader(const shm_reader&) = delete;
+    shm_reader& operator=(const shm_reader&) = delete;
+
+    // opens the segment created by a publisher, and fails if the publisher
+    // hasn't initialized it yet or publishes a value of another size
+    bool open(const std::string& name)
+    {
+        close();
+        segment = details::open_segment<T>(name);
+        return segment != nullptr;
+    }
+
+    bool is_open() const { return segment != nullptr; }
+
+    void close()
+    {
+        if (segment) {
+            details::unmap_segment(segment);
+            segment = nullptr;
+        }
+    }
+
+    // increases every time the publisher writes a value
+    std::uint32_t version() const
+    {
+        return segment->sequence.load(std::memory_order_acquire) / 2;
+    }
+
+    T load() const
+    {
+        std::uint64_t buffer[details::shm_segment<T>::num_words];
+
+        while (true) {
+            std::uint32_t before =
+                segment->sequence.load(std::memory_order_acquire);
+            if (before & 1) {
+                std::this_thread::yield();
+                continue;
+            }
+
+            for (std::size_t i = 0; i < details::shm_segment<T>::num_words;
+                 i++)
+                buffer[i] = segment->words[i].load(std::memory_order_relaxed);
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (segment->sequence.load(std::memory_order_relaxed) == before)
+                break;
+        }
+
+        T value;
+        std::memcpy(&value, buffer, sizeof(T));
+        return value;
+    }
+
+    // waits until version() differs from `seen`, returns false on timeout
+    template <typename Rep, typename Period>
+    bool wait_for_change(std::uint32_t seen,
+                         std::chrono::duration<Rep, Period> timeout) const
+    {
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+
+        segment->num_waiters.fetch_add(1, std::memory_order_seq_cst);
+
+        bool changed = true;
+        while (true) {
+            std::uint32_t sequence =
+                segment->sequence.load(std::memory_order_seq_cst);
+            if (sequence / 2 != seen)
+                break;
+
+            if (!details::wait_on(&segment->sequence, sequence, deadline)) {
+                changed = version() != seen;
+                break;
+            }
+        }
+
+        segment->num_waiters.fetch_sub(1, std::memory_order_seq_cst);
+        return changed;
+    }
+
+private:
+    details::shm_segment<T>* segment;
+};
+
+} // namespace bindable_properties
+
+#endif // SHM_PROPERTY_H
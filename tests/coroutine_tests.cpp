@@ -0,0 +1,211 @@
+#include <atomic>
+#include <cstdlib>
+#include <exception>
+#include <gtest/gtest.h>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "bindable_coroutines.h"
+
+namespace bp = bindable_properties;
+namespace co = bindable_properties::coroutines;
+
+static std::atomic<long> num_allocations{0};
+
+void* operator new(std::size_t size)
+{
+    num_allocations++;
+    if (void* ptr = std::malloc(size))
+        return ptr;
+    throw std::bad_alloc{};
+}
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+
+// resumes scheduled coroutines only when explicitly run, like an event loop
+struct run_loop {
+    run_loop() { queue.reserve(16); }
+
+    void schedule(std::coroutine_handle<> handle) { queue.push_back(handle); }
+
+    void run()
+    {
+        for (std::size_t i = 0; i < queue.size(); i++)
+            queue[i].resume();
+        queue.clear();
+    }
+
+    std::vector<std::coroutine_handle<>> queue;
+};
+
+// fire and forget coroutine
+struct task {
+    struct promise_type {
+        task get_return_object() { return {}; }
+        std::suspend_never initial_suspend() { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+TEST(CoroutineTests, AwaitChanged)
+{
+    run_loop loop;
+    bp::property<std::string> prop = std::string("initial");
+    std::vector<std::string> received;
+
+    auto coroutine = [&]() -> task {
+        received.push_back(co_await co::changed(prop, loop));
+        received.push_back(co_await co::changed(prop, loop));
+    };
+    coroutine();
+
+    EXPECT_TRUE(received.empty());
+    EXPECT_EQ(prop.num_views(), 1);
+
+    prop = std::string("first");
+    // resumption goes through the scheduler, never inline
+    EXPECT_TRUE(received.empty());
+
+    loop.run();
+    ASSERT_EQ(received.size(), 1);
+    EXPECT_EQ(received[0], "first");
+
+    prop = std::string("second");
+    loop.run();
+    ASSERT_EQ(received.size(), 2);
+    EXPECT_EQ(received[1], "second");
+
+    // the coroutine finished and dropped its subscription
+    EXPECT_EQ(prop.num_views(), 0);
+}
+
+TEST(CoroutineTests, AwaitChangedOfAView)
+{
+    run_loop loop;
+    bp::property<int> owner = 1;
+    bp::property<int> view = owner;
+    int received = 0;
+
+    auto coroutine = [&]() -> task {
+        received = co_await co::changed(view, loop);
+    };
+    coroutine();
+
+    owner = 5;
+    loop.run();
+    EXPECT_EQ(received, 5);
+}
+
+TEST(CoroutineTests, AwaitUntil)
+{
+    run_loop loop;
+    bp::property<int> prop = 0;
+    int received = -1;
+    bool done = false;
+
+    auto coroutine = [&]() -> task {
+        received = co_await co::until(
+            prop, [](int value) { return value >= 3; }, loop);
+        done = true;
+    };
+    coroutine();
+
+    for (int i = 1; i < 3; i++) {
+        prop = i;
+        loop.run();
+        EXPECT_FALSE(done);
+    }
+
+    prop = 3;
+    loop.run();
+    EXPECT_TRUE(done);
+    EXPECT_EQ(received, 3);
+}
+
+TEST(CoroutineTests, AwaitUntilAlreadySatisfied)
+{
+    run_loop loop;
+    bp::property<int> prop = 10;
+    int received = -1;
+
+    auto coroutine = [&]() -> task {
+        received = co_await co::until(
+            prop, [](int value) { return value == 10; }, loop);
+    };
+    coroutine();
+
+    EXPECT_EQ(received, 10);
+    EXPECT_TRUE(loop.queue.empty());
+}
+
+TEST(CoroutineTests, ChangeStreamCoalescesValues)
+{
+    run_loop loop;
+    bp::property<int> prop = 0;
+    std::vector<int> received;
+    received.reserve(16);
+
+    auto coroutine = [&]() -> task {
+        auto stream = co::changes(prop, loop);
+        while (received.size() < 3)
+            received.push_back(co_await stream.next());
+    };
+    coroutine();
+
+    prop = 1;
+    loop.run();
+    prop = 2;
+    prop = 3;
+    loop.run();
+    prop = 4;
+    loop.run();
+
+    EXPECT_EQ(received, (std::vector<int>{1, 3, 4}));
+    EXPECT_EQ(prop.num_views(), 0);
+}
+
+TEST(CoroutineTests, SteadyStateDoesNotAllocate)
+{
+    static constexpr int NUM_CHANGES = 1000;
+
+    run_loop loop;
+    bp::property<int> prop = 0;
+    bp::property<int> done_prop = 0;
+    long sum = 0;
+
+    auto awaiting_changed = [&]() -> task {
+        for (int i = 0; i < NUM_CHANGES; i++)
+            sum += co_await co::changed(prop, loop);
+    };
+    auto awaiting_stream = [&]() -> task {
+        auto stream = co::changes(prop, loop);
+        for (int i = 0; i < NUM_CHANGES; i++)
+            sum += co_await stream.next();
+    };
+    auto awaiting_until = [&]() -> task {
+        co_await co::until(
+            done_prop, [](int value) { return value != 0; }, loop);
+    };
+    awaiting_changed();
+    awaiting_stream();
+    awaiting_until();
+
+    // the first write of a thread sets up its propagation bookkeeping
+    bp::property<int> warm_up;
+    warm_up = 1;
+
+    long allocations_before = num_allocations;
+    for (int i = 1; i <= NUM_CHANGES; i++) {
+        prop = i;
+        loop.run();
+    }
+    done_prop = 1;
+    loop.run();
+
+    EXPECT_EQ(num_allocations - allocations_before, 0);
+    EXPECT_EQ(sum, 2L * NUM_CHANGES * (NUM_CHANGES + 1) / 2);
+}
@@ -0,0 +1,264 @@
+#include <atomic>
+#include <gtest/gtest.h>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "bindable_properties.h"
+#include "parallel_propagation.h"
+
+namespace bp = bindable_properties;
+
+class ParallelTests : public testing::TestWithParam<unsigned>
+{
+};
+INSTANTIATE_TEST_SUITE_P(NumThreads, ParallelTests,
+                         testing::Values(0u, 1u, 4u, 16u));
+
+// runs a batch on a pool of the given number of threads, or on the calling
+// thread without any pool for 0
+template <typename F>
+void with_batch(unsigned num_threads, F f)
+{
+    if (num_threads == 0) {
+        bp::propagation_batch batch;
+        f();
+    } else {
+        bp::thread_pool pool{num_threads};
+        bp::propagation_batch batch{pool};
+        f();
+    }
+}
+
+TEST_P(ParallelTests, BindingsAreDeferredUntilTheBatchEnds)
+{
+    bp::property<int> x = 1;
+    bp::property<int> y = 2;
+    bp::property<int> view = x;
+    bp::property<int> bound_prop;
+
+    std::atomic<int> evaluations{0};
+    bound_prop.set_binding([&]() {
+        evaluations++;
+        return x.value() + y.value();
+    });
+    evaluations = 0;
+
+    with_batch(GetParam(), [&]() {
+        x = 10;
+        y = 20;
+
+        // views are still updated right away
+        EXPECT_EQ(view.value(), 10);
+        EXPECT_EQ(bound_prop.value(), 3);
+    });
+
+    EXPECT_EQ(bound_prop.value(), 30);
+    EXPECT_EQ(evaluations, 1);
+
+    // without a batch, bindings are updated right away again
+    x = 100;
+    EXPECT_EQ(bound_prop.value(), 120);
+}
+
+TEST_P(ParallelTests, InputsAreEvaluatedBeforeOutputs)
+{
+    bp::property<int> x = 1;
+    bp::property<int> a;
+    bp::property<int> b;
+    bp::property<int> c;
+    bp::property<int> d;
+
+    std::atomic<int> evaluations{0};
+
+    a.set_binding([&]() { return x.value() + 1; });
+    b.set_binding([&]() { return x.value() * 2; });
+    c.set_binding([&]() {
+        evaluations++;
+        return a.value() + b.value();
+    });
+    d.set_binding([&]() {
+        evaluations++;
+        return c.value() + x.value();
+    });
+    evaluations = 0;
+
+    with_batch(GetParam(), [&]() { x = 5; });
+
+    EXPECT_EQ(a.value(), 6);
+    EXPECT_EQ(b.value(), 10);
+    EXPECT_EQ(c.value(), 16);
+    EXPECT_EQ(d.value(), 21);
+    EXPECT_EQ(evaluations, 2);
+}
+
+TEST_P(ParallelTests, IndependentChains)
+{
+    static constexpr int NUM_CHAINS = 64;
+    static constexpr int CHAIN_LENGTH = 8;
+
+    std::vector<std::unique_ptr<bp::property<long>>> inputs;
+    std::vector<std::unique_ptr<bp::property<long>>> chains;
+
+    for (int i = 0; i < NUM_CHAINS; i++) {
+        inputs.emplace_back(new bp::property<long>(0));
+
+        bp::property<long>* prev = inputs.back().get();
+        for (int j = 0; j < CHAIN_LENGTH; j++) {
+            chains.emplace_back(new bp::property<long>);
+            chains.back()->set_binding(
+                [prev, j]() { return prev->value() * 2 + j; });
+            prev = chains.back().get();
+        }
+    }
+
+    with_batch(GetParam(), [&]() {
+        for (int i = 0; i < NUM_CHAINS; i++)
+            *inputs[i] = i;
+    });
+
+    for (int i = 0; i < NUM_CHAINS; i++) {
+        long expected = i;
+        for (int j = 0; j < CHAIN_LENGTH; j++) {
+            expected = expected * 2 + j;
+            EXPECT_EQ(chains[i * CHAIN_LENGTH + j]->value(), expected);
+        }
+    }
+}
+
+TEST_P(ParallelTests, NestedBatchesFlushOnce)
+{
+    bp::property<int> x = 1;
+    bp::property<int> bound_prop;
+    bound_prop.set_binding([&]() { return x.value() * 10; });
+
+    with_batch(GetParam(), [&]() {
+        {
+            bp::propagation_batch inner;
+            x = 2;
+        }
+        EXPECT_EQ(bound_prop.value(), 10);
+    });
+
+    EXPECT_EQ(bound_prop.value(), 20);
+}
+
+TEST_P(ParallelTests, NotifiersWritingToOtherProperties)
+{
+    bp::property<int> x = 1;
+    bp::property<int> y = 0;
+    bp::property<int> bound_prop;
+    bp::property<int> bound_prop2;
+
+    bound_prop.set_binding([&]() { return x.value() + 1; }, bp::details::nop{},
+                           [&](int value) { y = value * 100; });
+    bound_prop2.set_binding([&]() { return y.value() + 1; });
+
+    with_batch(GetParam(), [&]() { x = 2; });
+
+    EXPECT_EQ(bound_prop.value(), 3);
+    EXPECT_EQ(y.value(), 300);
+    EXPECT_EQ(bound_prop2.value(), 301);
+}
+
+TEST_P(ParallelTests, CyclesAreStillCut)
+{
+    bp::property<double> celsius;
+    bp::property<double> fahrenheit;
+
+    fahrenheit.set_binding([&]() { return celsius.value() * 9 / 5 + 32; });
+    celsius.set_binding([&]() { return (fahrenheit.value() - 32) * 5 / 9; });
+
+    with_batch(GetParam(), [&]() { celsius = 100.0; });
+
+    EXPECT_EQ(fahrenheit.value(), 212.0);
+    EXPECT_EQ(celsius.value(), 100.0);
+}
+
+TEST(PropagationBatchTests, ThrowingBindingsReachFlush)
+{
+    for (unsigned num_threads : {1u, 4u}) {
+        bp::thread_pool pool{num_threads};
+        bp::property<int> x = 1;
+
+        std::vector<std::unique_ptr<bp::property<int>>> bound;
+        for (int i = 0; i < 8; i++) {
+            bound.emplace_back(new bp::property<int>);
+            bound.back()->set_binding([&x, i]() {
+                if (x.value() < 0)
+                    throw std::invalid_argument{"negative"};
+                return x.value() + i;
+            });
+        }
+
+        {
+            bp::propagation_batch batch{pool};
+            x = -1;
+            EXPECT_THROW(batch.flush(), std::invalid_argument);
+        }
+
+        // the destructor drops the exception instead of terminating
+        {
+            bp::propagation_batch batch{pool};
+            x = -2;
+        }
+
+        // neither the pool nor the batches are left in a broken state
+        {
+            bp::propagation_batch batch{pool};
+            x = 5;
+        }
+        for (int i = 0; i < 8; i++)
+            EXPECT_EQ(bound[i]->value(), 5 + i);
+    }
+}
+
+TEST(ThreadPoolTests, RunsEveryTaskOnce)
+{
+    static constexpr std::size_t NUM_TASKS = 10000;
+
+    bp::thread_pool pool{4};
+    EXPECT_EQ(pool.num_threads(), 4);
+
+    std::vector<std::atomic<int>> calls(NUM_TASKS);
+    for (int round = 0; round < 10; round++) {
+        pool.parallel_for(NUM_TASKS, [&](std::size_t index, unsigned thread) {
+            EXPECT_LT(thread, 4u);
+            calls[index]++;
+        });
+    }
+
+    for (std::atomic<int>& count : calls)
+        EXPECT_EQ(count, 10);
+}
+
+TEST(ThreadPoolTests, ConcurrentCallersDontMixTheirTasks)
+{
+    static constexpr std::size_t NUM_TASKS = 1000;
+    static constexpr int NUM_ROUNDS = 50;
+
+    bp::thread_pool pool{4};
+    std::atomic<int> calls[2] = {{0}, {0}};
+    std::atomic<int> running[4] = {{0}, {0}, {0}, {0}};
+    std::atomic<bool> overlapped{false};
+
+    auto caller = [&](int id) {
+        for (int round = 0; round < NUM_ROUNDS; round++) {
+            pool.parallel_for(NUM_TASKS, [&](std::size_t, unsigned thread) {
+                if (running[thread]++ != 0)
+                    overlapped = true;
+                calls[id]++;
+                running[thread]--;
+            });
+        }
+    };
+
+    std::thread other{caller, 1};
+    caller(0);
+    other.join();
+
+    EXPECT_EQ(calls[0], NUM_ROUNDS * static_cast<int>(NUM_TASKS));
+    EXPECT_EQ(calls[1], NUM_ROUNDS * static_cast<int>(NUM_TASKS));
+    EXPECT_FALSE(overlapped);
+}
@@ -0,0 +1,98 @@
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+#include "bindable_properties.h"
+#include "property_store.h"
+
+namespace bp = bindable_properties;
+
+TEST(PropertyStoreTests, CreateAndGet)
+{
+    bp::property_store<std::string> store;
+
+    bp::property_handle h = store.create("hello");
+    ASSERT_TRUE(store.valid(h));
+    ASSERT_NE(store.get(h), nullptr);
+    EXPECT_TRUE(store.get(h)->is_owner());
+    EXPECT_EQ(store.get(h)->value(), "hello");
+    EXPECT_EQ(store.size(), 1u);
+}
+
+TEST(PropertyStoreTests, StaleHandlesAreDetected)
+{
+    bp::property_store<int> store;
+
+    bp::property_handle h1 = store.create(1);
+    EXPECT_TRUE(store.destroy(h1));
+    EXPECT_FALSE(store.valid(h1));
+    EXPECT_EQ(store.get(h1), nullptr);
+    EXPECT_FALSE(store.destroy(h1));
+
+    // the slot is reused, but with a new generation
+    bp::property_handle h2 = store.create(2);
+    EXPECT_EQ(h2.index, h1.index);
+    EXPECT_NE(h2, h1);
+    EXPECT_FALSE(store.valid(h1));
+    EXPECT_EQ(store.get(h2)->value(), 2);
+
+    EXPECT_FALSE(store.valid(bp::property_handle{}));
+    EXPECT_FALSE(store.valid(bp::property_handle{1000, 1}));
+}
+
+TEST(PropertyStoreTests, AddressesStayStable)
+{
+    bp::property_store<int, 4> store;
+    std::vector<bp::property_handle> handles;
+
+    handles.push_back(store.create(0));
+    bp::property<int>* first = store.get(handles.front());
+
+    for (int i = 1; i < 100; i++)
+        handles.push_back(store.create(i));
+
+    EXPECT_EQ(store.get(handles.front()), first);
+    EXPECT_EQ(store.capacity(), 100u);
+    for (int i = 0; i < 100; i++)
+        EXPECT_EQ(store.get(handles[i])->value(), i);
+}
+
+TEST(PropertyStoreTests, ViewsInTheStoreFollowTheOwner)
+{
+    static constexpr int NUM_VIEWS = 1024;
+
+    bp::property<int> prop = 1;
+    bp::property_store<int> store;
+    std::vector<bp::property_handle> views;
+
+    for (int i = 0; i < NUM_VIEWS; i++)
+        views.push_back(store.create(prop));
+
+    // reordering the handles never touches the views themselves
+    std::reverse(views.begin(), views.end());
+    views.shrink_to_fit();
+
+    prop = 2;
+    for (bp::property_handle h : views) {
+        EXPECT_FALSE(store.get(h)->is_owner());
+        EXPECT_EQ(store.get(h)->value(), 2);
+    }
+    EXPECT_EQ(prop.num_views(), NUM_VIEWS);
+
+    for (int i = 0; i < NUM_VIEWS; i += 2)
+        store.destroy(views[i]);
+    EXPECT_EQ(prop.num_views(), NUM_VIEWS / 2);
+}
+
+TEST(PropertyStoreTests, DestroyingTheStoreDetachesViews)
+{
+    bp::property<int> prop = 1;
+    {
+        bp::property_store<int> store;
+        store.create(prop);
+        store.create(prop);
+        EXPECT_EQ(prop.num_views(), 2);
+    }
+    EXPECT_EQ(prop.num_views(), 0);
+}
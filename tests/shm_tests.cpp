@@ -0,0 +1,241 @@
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "bindable_properties.h"
+#include "shm_property.h"
+
+namespace bp = bindable_properties;
+
+namespace
+{
+
+struct record {
+    std::int64_t a, b, c, d;
+};
+
+std::string segment_name(const char* test)
+{
+    return "/bp_" + std::string{test} + "_" + std::to_string(getpid());
+}
+
+// runs child in a forked process, and returns whether it exited with true.
+// The child writes a byte to the pipe once it's ready, which the parent waits
+// for before calling parent
+template <typename Child, typename Parent>
+bool run_in_child(Child child, Parent parent)
+{
+    int fds[2];
+    if (pipe(fds) == -1)
+        return false;
+
+    pid_t pid = fork();
+    if (pid == -1)
+        return false;
+
+    if (pid == 0) {
+        ::close(fds[0]);
+        bool ok = child([&]() {
+            char byte = 1;
+            return write(fds[1], &byte, 1) == 1;
+        });
+        _exit(ok ? 0 : 1);
+    }
+
+    ::close(fds[1]);
+    char byte;
+    bool ready = read(fds[0], &byte, 1) == 1;
+    ::close(fds[0]);
+
+    if (ready)
+        parent();
+
+    int status;
+    waitpid(pid, &status, 0);
+    return ready && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+} // namespace
+
+TEST(ShmPropertyTests, MirrorsValues)
+{
+    std::string name = segment_name("mirror");
+    bp::property<int> prop{1};
+
+    bp::shm_publisher<int> publisher;
+    ASSERT_TRUE(publisher.open(name, prop));
+
+    bp::shm_reader<int> reader;
+    ASSERT_TRUE(reader.open(name));
+    EXPECT_EQ(reader.load(), 1);
+
+    std::uint32_t version = reader.version();
+    prop = 2;
+    EXPECT_EQ(reader.load(), 2);
+    EXPECT_NE(reader.version(), version);
+
+    // the reader keeps the mapping after the publisher goes away
+    publisher.close();
+    prop = 3;
+    EXPECT_EQ(reader.load(), 2);
+}
+
+TEST(ShmPropertyTests, MirrorsBoundProperties)
+{
+    std::string name = segment_name("bound");
+    bp::property<int> source{1};
+    bp::property<int> prop;
+    prop.set_binding([&]() { return source.value() * 10; });
+
+    bp::shm_publisher<int> publisher;
+    ASSERT_TRUE(publisher.open(name, prop));
+
+    bp::shm_reader<int> reader;
+    ASSERT_TRUE(reader.open(name));
+    EXPECT_EQ(reader.load(), 10);
+
+    source = 2;
+    EXPECT_EQ(reader.load(), 20);
+}
+
+TEST(ShmPropertyTests, OpenFailsWithoutPublisher)
+{
+    bp::shm_reader<int> reader;
+    EXPECT_FALSE(reader.open(segment_name("missing")));
+    EXPECT_FALSE(reader.is_open());
+}
+
+TEST(ShmPropertyTests, OpenFailsForAnotherType)
+{
+    std::string name = segment_name("mismatch");
+    bp::property<int> prop{1};
+
+    bp::shm_publisher<int> publisher;
+    ASSERT_TRUE(publisher.open(name, prop));
+
+    bp::shm_reader<record> reader;
+    EXPECT_FALSE(reader.open(name));
+    EXPECT_FALSE(reader.is_open());
+}
+
+TEST(ShmPropertyTests, OpenFailsForUninitializedSegments)
+{
+    std::string name = segment_name("raw");
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    ASSERT_NE(fd, -1);
+
+    // too small to hold the segment header
+    bp::shm_reader<int> reader;
+    EXPECT_FALSE(reader.open(name));
+
+    // large enough, but never initialized by a publisher
+    ASSERT_EQ(ftruncate(fd, 4096), 0);
+    ::close(fd);
+    EXPECT_FALSE(reader.open(name));
+
+    shm_unlink(name.c_str());
+}
+
+TEST(ShmPropertyTests, SecondPublisherFails)
+{
+    std::string name = segment_name("twice");
+    bp::property<int> prop{1};
+    bp::property<int> other{2};
+
+    bp::shm_publisher<int> publisher;
+    ASSERT_TRUE(publisher.open(name, prop));
+
+    bp::shm_publisher<int> second;
+    EXPECT_FALSE(second.open(name, other));
+
+    bp::shm_reader<int> reader;
+    ASSERT_TRUE(reader.open(name));
+    EXPECT_EQ(reader.load(), 1);
+
+    // the segment is reusable once its publisher closed it
+    publisher.close();
+    EXPECT_TRUE(second.open(name, other));
+}
+
+TEST(ShmPropertyTests, WaitForChangeTimesOut)
+{
+    std::string name = segment_name("timeout");
+    bp::property<int> prop{1};
+
+    bp::shm_publisher<int> publisher;
+    ASSERT_TRUE(publisher.open(name, prop));
+
+    bp::shm_reader<int> reader;
+    ASSERT_TRUE(reader.open(name));
+    EXPECT_FALSE(reader.wait_for_change(reader.version(),
+                                        std::chrono::milliseconds(10)));
+}
+
+TEST(ShmPropertyTests, NoTornReadsAcrossProcesses)
+{
+    std::string name = segment_name("torn");
+    const std::int64_t num_writes = 200000;
+    bp::property<record> prop{record{0, 0, 0, 0}};
+
+    bp::shm_publisher<record> publisher;
+    ASSERT_TRUE(publisher.open(name, prop));
+
+    auto child = [&](std::function<bool()> ready) {
+        bp::shm_reader<record> reader;
+        if (!reader.open(name) || !ready())
+            return false;
+
+        std::int64_t last = 0;
+        while (last != num_writes) {
+            record r = reader.load();
+            if (r.a != r.b || r.a != r.c || r.a != r.d || r.a < last)
+                return false;
+            last = r.a;
+        }
+        return true;
+    };
+
+    auto parent = [&]() {
+        for (std::int64_t i = 1; i <= num_writes; i++)
+            prop = record{i, i, i, i};
+    };
+
+    EXPECT_TRUE(run_in_child(child, parent));
+}
+
+TEST(ShmPropertyTests, WaitForChangeAcrossProcesses)
+{
+    std::string name = segment_name("wait");
+    bp::property<int> prop{1};
+
+    bp::shm_publisher<int> publisher;
+    ASSERT_TRUE(publisher.open(name, prop));
+
+    auto child = [&](std::function<bool()> ready) {
+        bp::shm_reader<int> reader;
+        if (!reader.open(name))
+            return false;
+
+        std::uint32_t version = reader.version();
+        if (!ready())
+            return false;
+
+        return reader.wait_for_change(version, std::chrono::seconds(10)) &&
+               reader.load() == 42;
+    };
+
+    auto parent = [&]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        prop = 42;
+    };
+
+    EXPECT_TRUE(run_in_child(child, parent));
+}
@@ -1,6 +1,9 @@
 #include <cmath>
 #include <gtest/gtest.h>
+#include <memory>
+#include <stdexcept>
 #include <string>
+#include <vector>
 
 #include "bindable_properties.h"
 
@@ -306,3 +309,668 @@ TEST(Tests, PythagorasExample)
     EXPECT_EQ(receivedValues[0], 29.0);
     EXPECT_EQ(receivedValues[1], 101.0);
 }
+
+TYPED_TEST(Tests, PeekDoesNotRegisterADependency)
+{
+    TypeParam value1 = new_value<TypeParam>(123);
+    TypeParam value2 = new_value<TypeParam>(223);
+
+    ASSERT_NE(value1, value2);
+
+    bp::property<TypeParam> tracked = value1;
+    bp::property<TypeParam> untracked = value1;
+    bp::property<TypeParam> bound_prop;
+
+    bound_prop.set_binding(
+        [&]() { return tracked.value() + untracked.peek(); });
+
+    EXPECT_EQ(bound_prop.value(), value1 + value1);
+
+    untracked = value2;
+    EXPECT_EQ(untracked.peek(), value2);
+    EXPECT_EQ(bound_prop.value(), value1 + value1);
+
+    tracked = value2;
+    EXPECT_EQ(bound_prop.value(), value2 + value2);
+}
+
+TYPED_TEST(Tests, ImplicitConversionReturnsAReference)
+{
+    TypeParam value = new_value<TypeParam>(123);
+    bp::property<TypeParam> prop = value;
+
+    const TypeParam& ref = prop;
+
+    EXPECT_EQ(std::addressof(ref), std::addressof(prop.peek()));
+    EXPECT_EQ(ref, value);
+}
+
+TYPED_TEST(Tests, ExpressionBindings)
+{
+    using namespace bp::expressions;
+
+    TypeParam value1 = new_value<TypeParam>(123);
+    TypeParam value2 = new_value<TypeParam>(223);
+    TypeParam value3 = new_value<TypeParam>(323);
+
+    bp::property<TypeParam> prop1 = value1;
+    bp::property<TypeParam> prop2 = value2;
+    bp::property<TypeParam> bound_prop;
+
+    EXPECT_TRUE(bound_prop.bind(prop1 + prop2 + prop1));
+    EXPECT_EQ(bound_prop.value(), value1 + value2 + value1);
+
+    prop1 = value3;
+    EXPECT_EQ(bound_prop.value(), value3 + value2 + value3);
+
+    prop2 = value1;
+    EXPECT_EQ(bound_prop.value(), value3 + value1 + value3);
+
+    bp::property<TypeParam> view = bound_prop;
+    EXPECT_FALSE(view.bind(prop1 + prop2));
+}
+
+TEST(Tests, ExpressionArithmeticAndComparison)
+{
+    using namespace bp::expressions;
+
+    bp::property<int> x = 3;
+    bp::property<int> y = 4;
+    bp::property<int> z;
+    bp::property<bool> x_is_bigger;
+    bp::property<bool> in_range;
+
+    auto e = x * 2 + y;
+    z.bind(e);
+    x_is_bigger.bind(x > y);
+    in_range.bind((!(x < 0) && x <= 10) || -y == 0);
+
+    EXPECT_EQ(z.value(), 10);
+    EXPECT_FALSE(x_is_bigger.value());
+    EXPECT_TRUE(in_range.value());
+
+    x = 11;
+    EXPECT_EQ(z.value(), 26);
+    EXPECT_TRUE(x_is_bigger.value());
+    EXPECT_FALSE(in_range.value());
+
+    y = 0;
+    EXPECT_EQ(z.value(), 22);
+    EXPECT_TRUE(in_range.value());
+}
+
+TEST(Tests, ExpressionBindingsChainAndNotify)
+{
+    using namespace bp::expressions;
+
+    bp::property<int> x = 1;
+    bp::property<int> y;
+    bp::property<double> z;
+
+    int notificationsReceived = 0;
+
+    y.bind(x * x - 1);
+    z.bind(y / 2.0, bp::details::nop{}, [&](double value) {
+        notificationsReceived++;
+        EXPECT_EQ(value, z.value());
+    });
+
+    EXPECT_EQ(z.value(), 0.0);
+    EXPECT_EQ(notificationsReceived, 1);
+
+    x = 3;
+    EXPECT_EQ(y.value(), 8);
+    EXPECT_EQ(z.value(), 4.0);
+    EXPECT_EQ(notificationsReceived, 2);
+
+    // rebinding drops the subscriptions of the previous expression
+    y.bind(x % 2);
+    EXPECT_EQ(y.value(), 1);
+    EXPECT_EQ(x.num_views(), 1);
+}
+
+TEST(Tests, BindingStateIsReclaimed)
+{
+    using namespace bp::expressions;
+
+    std::size_t initial_states = bp::live_binding_states();
+
+    bp::property<int> x = 1;
+    bp::property<int> other = 7;
+    {
+        bp::property<int> bound_prop;
+        bound_prop.set_binding([&]() { return x.value() + 1; });
+        EXPECT_EQ(bp::live_binding_states(), initial_states + 1);
+        EXPECT_EQ(x.num_views(), 1);
+
+        // rebinding releases the previous binding state
+        bound_prop.bind(x + 2);
+        EXPECT_EQ(bp::live_binding_states(), initial_states + 1);
+        EXPECT_EQ(x.num_views(), 1);
+
+        // so does becoming a view
+        bound_prop = other;
+        EXPECT_EQ(bp::live_binding_states(), initial_states);
+        EXPECT_EQ(x.num_views(), 0);
+
+        bound_prop.become_owner();
+        bound_prop.set_binding([&]() { return x.value() * 2; });
+        EXPECT_EQ(bp::live_binding_states(), initial_states + 1);
+    }
+
+    // and being destroyed
+    EXPECT_EQ(bp::live_binding_states(), initial_states);
+    EXPECT_EQ(x.num_views(), 0);
+}
+
+TEST(Tests, RebindingChurnKeepsMemoryFlat)
+{
+    using namespace bp::expressions;
+
+    static constexpr int NUM_REBINDS = 100000;
+
+    std::size_t initial_states = bp::live_binding_states();
+
+    bp::property<int> x = 1;
+    bp::property<int> y = 2;
+    bp::property<int> bound_prop;
+    bp::property<int> bound_prop2;
+
+    bound_prop2.set_binding([&]() { return bound_prop.value() * 2; });
+
+    for (int i = 0; i < NUM_REBINDS; i++) {
+        if (i % 2 == 0)
+            bound_prop.set_binding([&]() { return x.value() + y.value(); });
+        else
+            bound_prop.bind(x - y);
+
+        x = i;
+
+        EXPECT_EQ(bp::live_binding_states(), initial_states + 2);
+        EXPECT_EQ(x.num_views(), 1);
+        EXPECT_EQ(y.num_views(), 1);
+        // the binding of bound_prop2, and bound_prop's own binding
+        EXPECT_EQ(bound_prop.num_views(), 2);
+    }
+
+    EXPECT_EQ(bound_prop2.value(), 2 * (x.value() - y.value()));
+}
+
+TEST(Tests, MutuallyBoundPropertiesStopTheCycle)
+{
+    bp::property<double> celsius;
+    bp::property<double> fahrenheit;
+
+    fahrenheit.set_binding([&]() { return celsius.value() * 9 / 5 + 32; });
+    celsius.set_binding([&]() { return (fahrenheit.value() - 32) * 5 / 9; });
+
+    EXPECT_EQ(celsius.value(), 0.0);
+    EXPECT_EQ(fahrenheit.value(), 32.0);
+
+    celsius = 100.0;
+    EXPECT_EQ(celsius.value(), 100.0);
+    EXPECT_EQ(fahrenheit.value(), 212.0);
+
+    fahrenheit = 50.0;
+    EXPECT_EQ(celsius.value(), 10.0);
+    EXPECT_EQ(fahrenheit.value(), 50.0);
+}
+
+TEST(Tests, TwoWayUnitConversionWithSetters)
+{
+    bp::property<double> celsius;
+    bp::property<double> fahrenheit;
+
+    int celsius_setter_calls = 0;
+    int fahrenheit_setter_calls = 0;
+
+    fahrenheit.set_binding(
+        [&]() { return celsius.value() * 9 / 5 + 32; },
+        [&](double value) {
+            fahrenheit_setter_calls++;
+            celsius.request_change((value - 32) * 5 / 9);
+        });
+    celsius.set_binding(
+        [&]() { return (fahrenheit.value() - 32) * 5 / 9; },
+        [&](double value) {
+            celsius_setter_calls++;
+            fahrenheit.request_change(value * 9 / 5 + 32);
+        });
+
+    celsius.request_change(100.0);
+    EXPECT_EQ(celsius.value(), 100.0);
+    EXPECT_EQ(fahrenheit.value(), 212.0);
+    EXPECT_EQ(celsius_setter_calls, 1);
+    EXPECT_EQ(fahrenheit_setter_calls, 1);
+
+    fahrenheit.request_change(-40.0);
+    EXPECT_EQ(celsius.value(), -40.0);
+    EXPECT_EQ(fahrenheit.value(), -40.0);
+    EXPECT_EQ(celsius_setter_calls, 2);
+    EXPECT_EQ(fahrenheit_setter_calls, 2);
+}
+
+TEST(Tests, SettersStillRunAfterOneThrew)
+{
+    bp::property<int> prop = 0;
+    int calls = 0;
+    prop.set_setter([&](bp::property<int>& p, int value) {
+        calls++;
+        if (value < 0)
+            throw std::invalid_argument("negative");
+        p = value;
+    });
+
+    bp::property<int> view = prop;
+    EXPECT_THROW(view.request_change(-1), std::invalid_argument);
+    EXPECT_EQ(calls, 1);
+
+    // the failed request doesn't leave prop flagged as running its setter,
+    // which would accept the next request without validating it
+    EXPECT_THROW(view.request_change(-7), std::invalid_argument);
+    EXPECT_EQ(calls, 2);
+    EXPECT_EQ(prop.value(), 0);
+
+    view.request_change(5);
+    EXPECT_EQ(calls, 3);
+    EXPECT_EQ(prop.value(), 5);
+}
+
+TEST(Tests, FixedPointIterations)
+{
+    bp::property<double> a;
+    bp::property<double> b;
+
+    // the constraints a = (b + 10) / 2 and b = a converge to a = b = 10
+    a.set_binding([&]() { return (b.value() + 10) / 2; });
+    b.set_binding([&]() { return a.value(); });
+
+    // by default the cycle is cut as soon as it's detected
+    a = 0.0;
+    EXPECT_EQ(a.value(), 0.0);
+    EXPECT_EQ(b.value(), 0.0);
+
+    bp::set_max_cycle_iterations(200);
+    a = 0.0;
+    bp::set_max_cycle_iterations(0);
+
+    EXPECT_NEAR(a.value(), 10.0, 1e-9);
+    EXPECT_EQ(b.value(), a.value());
+}
+
+TEST(Tests, FixedPointIterationsAreBounded)
+{
+    bp::property<int> a;
+    bp::property<int> b;
+
+    // never converges
+    a.set_binding([&]() { return b.value() + 1; });
+    b.set_binding([&]() { return a.value(); });
+
+    bp::set_max_cycle_iterations(10);
+    a = 0;
+    bp::set_max_cycle_iterations(0);
+
+    EXPECT_EQ(a.value(), 10);
+    EXPECT_EQ(b.value(), 10);
+}
+
+TYPED_TEST(Tests, NotifiersWithOldAndNewValues)
+{
+    TypeParam value1 = new_value<TypeParam>(123);
+    TypeParam value2 = new_value<TypeParam>(223);
+    TypeParam value3 = new_value<TypeParam>(323);
+
+    bp::property<TypeParam> prop = value1;
+    bp::property<TypeParam> view = prop;
+    bp::property<TypeParam> bound_prop;
+
+    std::vector<std::pair<TypeParam, TypeParam>> view_changes;
+    std::vector<std::pair<TypeParam, TypeParam>> bound_changes;
+
+    view.set_notifier([&](const TypeParam& old_value, const TypeParam& value) {
+        view_changes.emplace_back(old_value, value);
+    });
+    bound_prop.set_binding(
+        [&]() { return prop.value(); }, bp::details::nop{},
+        [&](bp::property<TypeParam>& self, const TypeParam& old_value,
+            const TypeParam& value) {
+            EXPECT_EQ(std::addressof(self), std::addressof(bound_prop));
+            bound_changes.emplace_back(old_value, value);
+        });
+
+    prop = value2;
+    prop = value3;
+
+    ASSERT_EQ(view_changes.size(), 2);
+    EXPECT_EQ(view_changes[0], std::make_pair(value1, value2));
+    EXPECT_EQ(view_changes[1], std::make_pair(value2, value3));
+
+    // the first change is the initial binding
+    ASSERT_EQ(bound_changes.size(), 3);
+    EXPECT_EQ(bound_changes[1], std::make_pair(value1, value2));
+    EXPECT_EQ(bound_changes[2], std::make_pair(value2, value3));
+
+    // ownership can be transferred while keeping the old values flowing
+    bp::property<TypeParam> new_owner = std::move(prop);
+    new_owner = value1;
+
+    ASSERT_EQ(view_changes.size(), 3);
+    EXPECT_EQ(view_changes[2], std::make_pair(value3, value1));
+}
+
+struct copy_counter {
+    copy_counter(int value_ = 0) : value{value_} {}
+    copy_counter(const copy_counter& other) : value{other.value} { copies++; }
+    copy_counter(copy_counter&& other) noexcept : value{other.value} {}
+
+    copy_counter& operator=(const copy_counter& other)
+    {
+        value = other.value;
+        copies++;
+        return *this;
+    }
+    copy_counter& operator=(copy_counter&& other) noexcept
+    {
+        value = other.value;
+        return *this;
+    }
+
+    bool operator==(const copy_counter& other) const
+    {
+        return value == other.value;
+    }
+
+    int value;
+    static int copies;
+};
+
+int copy_counter::copies = 0;
+
+TEST(Tests, OldValuesDoNotCostExtraCopies)
+{
+    auto copies_per_write = [](bool with_old_value) {
+        bp::property<copy_counter> prop;
+        bp::property<copy_counter> view = prop;
+        bp::property<copy_counter> notifying_view = prop;
+
+        int old_value = -1;
+        int new_value = -1;
+        if (with_old_value) {
+            notifying_view.set_notifier(
+                [&](const copy_counter& old_val, const copy_counter& val) {
+                    old_value = old_val.value;
+                    new_value = val.value;
+                });
+        } else {
+            notifying_view.set_notifier(
+                [&](const copy_counter& val) { new_value = val.value; });
+        }
+
+        copy_counter value{5};
+
+        int copies_before = copy_counter::copies;
+        prop = value;
+        int copies = copy_counter::copies - copies_before;
+
+        EXPECT_EQ(new_value, 5);
+        if (with_old_value) {
+            EXPECT_EQ(old_value, 0);
+        }
+
+        return copies;
+    };
+
+    EXPECT_EQ(copies_per_write(true), copies_per_write(false));
+}
+
+TEST(Tests, WritesAreNotCopiedIntoViews)
+{
+    static constexpr int NUM_VIEWS = 100;
+
+    bp::property<copy_counter> prop;
+    std::vector<bp::property<copy_counter>> views;
+    for (int i = 0; i < NUM_VIEWS; i++)
+        views.emplace_back(prop);
+
+    int copies_before = copy_counter::copies;
+    prop = copy_counter{5};
+    EXPECT_EQ(copy_counter::copies - copies_before, 1);
+
+    for (const auto& view : views)
+        EXPECT_EQ(view.value().value, 5);
+}
+
+TYPED_TEST(Tests, ViewsKeepTheirValueWhenTheOwnerGoesAway)
+{
+    TypeParam v1 = new_value<TypeParam>(123);
+    TypeParam v2 = new_value<TypeParam>(200);
+
+    bp::property<TypeParam> view_prop;
+    {
+        bp::property<TypeParam> prop = v1;
+        view_prop = prop;
+    }
+    EXPECT_TRUE(view_prop.is_zombie());
+    EXPECT_EQ(view_prop.value(), v1);
+
+    // an owner that becomes a view of another property drops its views
+    bp::property<TypeParam> prop = v1;
+    bp::property<TypeParam> other = v2;
+    bp::property<TypeParam> view1 = prop;
+    bp::property<TypeParam> view2 = prop;
+    prop = other;
+
+    EXPECT_TRUE(view1.is_zombie());
+    EXPECT_TRUE(view2.is_zombie());
+    EXPECT_EQ(view1.value(), v1);
+    EXPECT_EQ(view2.value(), v1);
+    EXPECT_EQ(prop.value(), v2);
+
+    // so does an owner that becomes an owner anew
+    bp::property<TypeParam> view3 = other;
+    other.become_owner();
+    EXPECT_TRUE(view3.is_zombie());
+    EXPECT_EQ(view3.value(), v2);
+
+    // and a view that becomes an owner keeps its value
+    bp::property<TypeParam> view4 = other;
+    view4.become_owner();
+    EXPECT_TRUE(view4.is_owner());
+    EXPECT_EQ(view4.value(), v2);
+}
+
+TEST(Tests, NotifiersSeeTheNewValueOfAllViews)
+{
+    bp::property<int> prop = 1;
+    bp::property<int> view1 = prop;
+    bp::property<int> view2 = prop;
+
+    int seen_by_view1 = 0;
+    int seen_by_view2 = 0;
+    view1.set_notifier([&]() { seen_by_view1 = view2.value(); });
+    view2.set_notifier([&]() { seen_by_view2 = view1.value(); });
+
+    prop = 2;
+    EXPECT_EQ(seen_by_view1, 2);
+    EXPECT_EQ(seen_by_view2, 2);
+}
+
+TEST(Tests, ViewsCanBeDetachedWhileNotified)
+{
+    static constexpr int NUM_VIEWS = 8;
+
+    bp::property<int> prop = 0;
+    std::vector<bp::property<int>> views(NUM_VIEWS);
+    std::vector<int> notified(NUM_VIEWS, 0);
+
+    for (int i = 0; i < NUM_VIEWS; i++) {
+        views[i] = prop;
+        views[i].set_notifier([&, i]() { notified[i]++; });
+    }
+
+    // detaches an already notified view, and one that is still to be
+    // notified, without skipping any of the others
+    views[2].set_notifier([&]() {
+        notified[2]++;
+        views[0].become_owner();
+        views[5].become_owner();
+    });
+
+    prop = 1;
+    EXPECT_EQ(notified, (std::vector<int>{1, 1, 1, 1, 1, 0, 1, 1}));
+    EXPECT_EQ(prop.num_views(), NUM_VIEWS - 2);
+
+    prop = 2;
+    EXPECT_EQ(notified, (std::vector<int>{1, 2, 2, 2, 2, 0, 2, 2}));
+    EXPECT_EQ(prop.num_views(), NUM_VIEWS - 2);
+
+    // moving the owner away while it notifies hands the empty slots over to
+    // the new owner, which must not keep them around
+    bp::property<int> a = 0;
+    bp::property<int> b;
+    bp::property<int> v0 = a;
+    bp::property<int> v1 = a;
+    bp::property<int> v2 = a;
+    v0.set_notifier([&]() {
+        v1.become_owner();
+        b = std::move(a);
+    });
+
+    a = 1;
+    EXPECT_EQ(b.num_views(), 2);
+    EXPECT_EQ(v2.value(), 1);
+
+    a = 2;
+    v0.become_owner();
+    v2.become_owner();
+    EXPECT_EQ(b.num_views(), 0);
+}
+
+struct config {
+    int timeout;
+    int retries;
+    std::string host;
+};
+
+TEST(Tests, SelectorsOnlyChangeWithTheirMember)
+{
+    bp::property<config> cfg = config{10, 3, "localhost"};
+    auto timeout = cfg.select(&config::timeout);
+
+    int notifications = 0;
+    timeout.set_notifier([&](int) { notifications++; });
+
+    EXPECT_EQ(timeout.value(), 10);
+
+    cfg = config{10, 5, "example.com"};
+    EXPECT_EQ(notifications, 0);
+
+    cfg = config{20, 5, "example.com"};
+    EXPECT_EQ(notifications, 1);
+    EXPECT_EQ(timeout.value(), 20);
+
+    // views of a selector follow the member as well
+    bp::property<int> view = timeout.as_property();
+    cfg = config{30, 5, "example.com"};
+    EXPECT_EQ(view.value(), 30);
+}
+
+TEST(Tests, BindingsOnSelectorsIgnoreOtherMembers)
+{
+    bp::property<config> cfg = config{10, 3, "localhost"};
+    auto timeout = cfg.select(&config::timeout);
+
+    int evaluations = 0;
+    bp::property<int> doubled;
+    doubled.set_binding([&]() {
+        evaluations++;
+        return timeout.value() * 2;
+    });
+    EXPECT_EQ(evaluations, 1);
+    EXPECT_EQ(doubled.value(), 20);
+
+    cfg = config{10, 4, "localhost"};
+    EXPECT_EQ(evaluations, 1);
+
+    cfg = config{15, 4, "localhost"};
+    EXPECT_EQ(evaluations, 2);
+    EXPECT_EQ(doubled.value(), 30);
+}
+
+TEST(Tests, SelectorsCanBeMoved)
+{
+    bp::property<config> cfg = config{1, 0, ""};
+
+    std::vector<bp::property_selector<config, int>> selectors;
+    for (int i = 0; i < 16; i++)
+        selectors.push_back(cfg.select(&config::timeout));
+
+    bp::property<int> sum;
+    sum.set_binding([&]() {
+        int result = 0;
+        for (const auto& selector : selectors)
+            result += selector.value();
+        return result;
+    });
+    EXPECT_EQ(sum.value(), 16);
+
+    // one subscription per selector, none left behind by the moves
+    EXPECT_EQ(cfg.num_views(), 16);
+
+    cfg = config{2, 0, ""};
+    EXPECT_EQ(sum.value(), 32);
+}
+
+TEST(Tests, SelectorsKeepTheirNotifierWhenMoved)
+{
+    bp::property<config> cfg = config{1, 0, ""};
+    auto timeout = cfg.select(&config::timeout);
+
+    int notifications = 0;
+    timeout.set_notifier([&](int) { notifications++; });
+
+    auto moved = std::move(timeout);
+    cfg = config{2, 0, ""};
+    EXPECT_EQ(notifications, 1);
+    EXPECT_EQ(moved.value(), 2);
+
+    auto assigned = cfg.select(&config::retries);
+    assigned = std::move(moved);
+    cfg = config{3, 0, ""};
+    EXPECT_EQ(notifications, 2);
+    EXPECT_EQ(assigned.value(), 3);
+
+    // moving a selector into itself leaves it as it was
+    auto& same = assigned;
+    assigned = std::move(same);
+    cfg = config{4, 0, ""};
+    EXPECT_EQ(notifications, 3);
+    EXPECT_EQ(assigned.value(), 4);
+    EXPECT_EQ(cfg.num_views(), 1);
+}
+
+TEST(Tests, SelectorsRequestChangesOfTheirMember)
+{
+    bp::property<config> cfg = config{10, 3, "localhost"};
+    auto retries = cfg.select(&config::retries);
+
+    retries.request_change(7);
+    EXPECT_EQ(cfg.value().retries, 7);
+    EXPECT_EQ(cfg.value().timeout, 10);
+    EXPECT_EQ(retries.value(), 7);
+}
+
+TEST(Tests, SelectorsKeepTheirValueWhenTheSourceGoesAway)
+{
+    std::unique_ptr<bp::property<config>> cfg{
+        new bp::property<config>{config{10, 3, "localhost"}}};
+    auto host = cfg->select(&config::host);
+
+    cfg.reset();
+    EXPECT_EQ(host.value(), "localhost");
+
+    // nothing to request the change from anymore
+    host.request_change("example.com");
+    EXPECT_EQ(host.value(), "localhost");
+}